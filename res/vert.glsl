@@ -1,25 +1,85 @@
 #version 330
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
-layout(location = 2) in vec3 tex;
+#ifdef FACE_RECORDS
+// One record per face, see makeChunkFace in gfx/ChunkVertex.h, read out
+// of MeshArena's vertex buffer. gl_VertexID / 4 is the record's index,
+// and gl_VertexID % 4 which of the quad's corners this is.
+uniform usamplerBuffer faces;
+// Per draw, from MeshArena
+layout(location = 1) in vec3 chunk_offset;
+#else
+// See gfx/ChunkVertex.h for the packed layout
+layout(location = 0) in uvec4 position_normal;
+layout(location = 1) in uvec4 tex_layer;
+// Per draw, from MeshArena
+layout(location = 2) in vec3 chunk_offset;
+#endif
+#ifdef PLANT_INSTANCES
+// Per instance, from ChunkMeshManager's plant arena. See PlantInstance in
+// gfx/ChunkVertex.h.
+layout(location = 3) in uvec4 plant;
+#endif
 
 uniform mat4 perspective;
 uniform mat4 modelview;
 
-const vec4 lightdir = normalize(vec4(.3, .5, -1, 0));
+#ifdef FACE_RECORDS
+// Indexed by Face, as GreedyMesher lays faces out: the chunk axes the
+// texture's u and v run along, whether each is flipped, and whether the
+// corners go along u first, to keep the winding counter-clockwise
+const ivec2 face_axes[6] = ivec2[](
+    ivec2(1, 2), ivec2(1, 2), ivec2(0, 2), ivec2(0, 2), ivec2(0, 1), ivec2(0, 1));
+const bvec2 face_flips[6] = bvec2[](
+    bvec2(false, false), bvec2(true, false), bvec2(true, false),
+    bvec2(false, false), bvec2(false, false), bvec2(false, true));
+const bool face_ccw[6] = bool[](true, false, false, true, true, false);
+
+// The shading chunkShade in gfx/ChunkVertex.cpp bakes into vertices
+const vec3 normals[6] = vec3[](
+    vec3(1, 0, 0), vec3(-1, 0, 0),
+    vec3(0, 1, 0), vec3(0, -1, 0),
+    vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 sundir = normalize(vec3(.3, .5, -1));
+const float occlusion_light[4] = float[](1, .8, .65, .5);
+#endif
 
-smooth out vec4 fragpos;
-smooth out vec4 fragnormal;
-smooth out vec4 fraglight1;
-smooth out vec4 fraglight2pos;
 smooth out vec3 fragtex;
+smooth out float fragshade;
 
 void main() {
-    fragpos = modelview*vec4(position, 1);
-    gl_Position = perspective*fragpos;
-    fragnormal = normalize(modelview*vec4(normal, 0));
-    fraglight1 = normalize(modelview*lightdir);
-    fraglight2pos = vec4(0, 0, 0, 1);
+#ifdef FACE_RECORDS
+    uvec2 record = texelFetch(faces, gl_VertexID >> 2).xy;
+    int face = int((record.x >> 18) & 7u);
+    vec2 size = vec2((record.x >> 21) & 31u, (record.x >> 26) & 31u) + 1.0;
+    int corner = gl_VertexID & 3;
+    if ((record.x >> 31) != 0u) {
+        // Flipped quads take the corners in the order 1 3 0 2
+        corner = (((corner & 1) << 1) | (corner >> 1)) ^ 1;
+    }
+    ivec2 side = face_ccw[face] ? ivec2(corner & 1, corner >> 1)
+                                : ivec2(corner >> 1, corner & 1);
+    vec2 extent = vec2(side)*size;
+
+    vec3 position = vec3(record.x & 63u, (record.x >> 6) & 63u, (record.x >> 12) & 63u);
+    position[face_axes[face].x] += extent.x;
+    position[face_axes[face].y] += extent.y;
+    position += chunk_offset;
+    vec3 tex = vec3(mix(extent, size - extent, face_flips[face]), float(record.y & 255u));
+
+    uint occlusion = (record.y >> (8 + 2*(side.x + 2*side.y))) & 3u;
+    float sun = clamp(-dot(normals[face], sundir), .2, 1.0);
+    float shade = round(255*sun*occlusion_light[occlusion]) / 255;
+#else
+    vec3 position = vec3(position_normal.xyz) + chunk_offset;
+    vec3 tex = vec3(tex_layer.xyz);
+    float shade = float(tex_layer.w) / 255;
+#endif
+#ifdef PLANT_INSTANCES
+    position += vec3(plant.xyz);
+    tex.z = float(plant.w);
+#endif
+
+    gl_Position = perspective*modelview*vec4(position, 1);
     fragtex = tex;
+    fragshade = shade;
 }
@@ -7,7 +7,10 @@
 #include <unordered_map>
 
 struct BlockTypeInfo {
+    // Solid blocks also stop light
     bool solid = true;
+    // The block light level given off, up to ChunkLight::MaxLevel
+    unsigned int light = 0;
 };
 
 struct BlockType : public BlockTypeInfo {
@@ -12,6 +12,8 @@ public:
 
     const BlockType &getType(const std::string &name) const;
     const BlockType &getType(BlockType::ID id) const;
+    // IDs run from 0 to getTypeCount()-1
+    unsigned int getTypeCount() const { return types_by_id.size(); }
 
     void dump(std::ostream &out) const;
     
@@ -56,6 +56,12 @@ public:
     Block getBlock(unsigned int offset) const;
     void setBlock(unsigned int offset, const Block &block);
 
+    // Raw ID access, for loops which do their own per type lookups
+    BlockType::ID getBlockID(unsigned int offset) const { return data[offset]; }
+    // Blocks along z are contiguous, starting at the offset of z=0
+    const BlockType::ID *getBlockIDs(unsigned int offset) const { return &data[offset]; }
+    const BlockTypeRegistry &getBlockTypes() const { return *reg; }
+
     Block getBlock(const ChunkIndex &index) const {
         return getBlock(index.getOffset());
     }
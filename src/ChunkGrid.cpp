@@ -1,6 +1,11 @@
 #include "ChunkGrid.h"
+#include <algorithm>
+#include <limits>
+#include <cassert>
 
-ChunkGrid::ChunkGrid() { }
+ChunkGrid::ChunkGrid() :
+    min_z(std::numeric_limits<int>::max()),
+    max_z(std::numeric_limits<int>::min()) { }
 
 std::shared_ptr<const Chunk> ChunkGrid::getChunk(const glm::ivec3 &pos) const {
     auto iter = chunks.find(pos);
@@ -11,13 +16,72 @@ std::shared_ptr<const Chunk> ChunkGrid::getChunk(const glm::ivec3 &pos) const {
     }
 }
 
+ChunkNeighborhood ChunkGrid::getNeighborhood(const glm::ivec3 &pos) const {
+    ChunkNeighborhood neighborhood;
+    neighborhood.chunk = getChunk(pos);
+    for (Face face : all_faces) {
+        neighborhood.neighbors[face] = getChunk(adjacentPos(pos, face));
+    }
+    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+        neighborhood.diagonals[i] = getChunk(pos + ChunkNeighborhood::diagonal_offsets[i]);
+    }
+    return neighborhood;
+}
+
 void ChunkGrid::setChunk(const glm::ivec3 &pos, std::shared_ptr<Chunk> chunk) {
     auto &entry = chunks[pos];
     entry.chunk = std::move(chunk);
+    min_z = std::min(min_z, pos.z);
+    max_z = std::max(max_z, pos.z);
 }
 
 void ChunkGrid::clearAllChunks() {
     chunks.clear();
+    min_z = std::numeric_limits<int>::max();
+    max_z = std::numeric_limits<int>::min();
+}
+
+std::shared_ptr<const ChunkLight> ChunkGrid::getLight(const glm::ivec3 &pos) const {
+    auto iter = chunks.find(pos);
+    if (iter == chunks.end()) {
+        return nullptr;
+    } else {
+        return iter->second.light;
+    }
+}
+
+void ChunkGrid::setLight(const glm::ivec3 &pos, std::shared_ptr<const ChunkLight> light) {
+    auto iter = chunks.find(pos);
+    assert(iter != chunks.end());
+    iter->second.light = std::move(light);
+}
+
+ChunkGrid ChunkGrid::copyColumns(const glm::ivec2 &min, const glm::ivec2 &max) const {
+    ChunkGrid copy;
+    for (int x = min.x; x <= max.x; x++) {
+        for (int y = min.y; y <= max.y; y++) {
+            for (int z = min_z; z <= max_z; z++) {
+                const glm::ivec3 pos{x, y, z};
+                auto iter = chunks.find(pos);
+                if (iter != chunks.end()) {
+                    copy.chunks.emplace(pos, iter->second);
+                    copy.min_z = std::min(copy.min_z, z);
+                    copy.max_z = std::max(copy.max_z, z);
+                }
+            }
+        }
+    }
+    return copy;
+}
+
+bool ChunkGrid::matches(const ChunkGrid &snapshot) const {
+    for (const auto &item : snapshot.chunks) {
+        auto iter = chunks.find(item.first);
+        if (iter == chunks.end() || iter->second.light != item.second.light) {
+            return false;
+        }
+    }
+    return true;
 }
 
 Optional<Block> ChunkGrid::findBlock(glm::ivec3 &pos) const {
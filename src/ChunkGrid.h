@@ -2,6 +2,8 @@
 #define CHUNKGRID_H
 
 #include "Chunk.h"
+#include "ChunkLight.h"
+#include "ChunkNeighborhood.h"
 #include "util/math.h"
 #include "util/Optional.h"
 
@@ -14,9 +16,26 @@ public:
     ChunkGrid();
 
     std::shared_ptr<const Chunk> getChunk(const glm::ivec3 &pos) const;
+    unsigned int getChunkCount() const { return chunks.size(); }
+    ChunkNeighborhood getNeighborhood(const glm::ivec3 &pos) const;
 
+    // Keeps the light of any chunk already at pos, for
+    // LightPropagator::updateBlock to bring up to date
     void setChunk(const glm::ivec3 &pos, std::shared_ptr<Chunk> chunk);
     void clearAllChunks();
+
+    // The chunk's light, or null while it's yet to be lit, or if there's
+    // no chunk at pos. Unlit chunks are left out of light propagation.
+    std::shared_ptr<const ChunkLight> getLight(const glm::ivec3 &pos) const;
+    // pos must have a chunk
+    void setLight(const glm::ivec3 &pos, std::shared_ptr<const ChunkLight> light);
+
+    // The chunks and their light in columns min to max inclusive, as a
+    // snapshot for the workers, which shares rather than copies them
+    ChunkGrid copyColumns(const glm::ivec2 &min, const glm::ivec2 &max) const;
+    // True if every chunk of snapshot is still here with the same light.
+    // The blocks may have changed since.
+    bool matches(const ChunkGrid &snapshot) const;
     
     Optional<Block> findBlock(glm::ivec3 &pos) const;
 
@@ -29,10 +48,14 @@ public:
 private:
     struct Entry {
         std::shared_ptr<Chunk> chunk;
+        std::shared_ptr<const ChunkLight> light;
     };
 
     using ChunkMap = std::unordered_map<glm::ivec3, Entry>;
     ChunkMap chunks;
+    // The heights chunks have been set at, so that columns can be walked
+    int min_z;
+    int max_z;
 };
 
 #endif
@@ -0,0 +1,52 @@
+#ifndef CHUNKLIGHT_H
+#define CHUNKLIGHT_H
+
+#include "Chunk.h"
+
+#include <array>
+#include <cstdint>
+
+// A chunk's light levels, 0 to MaxLevel, as two nibbles per byte at the
+// chunk's block offsets (see ChunkIndex::getOffset). Block light is
+// given off by blocks, sky light comes down from open sky. Kept apart
+// from the Chunk, and shared between snapshots like it, so that relighting
+// doesn't copy the blocks. Starts out dark.
+class ChunkLight {
+public:
+    static constexpr int MaxLevel = 15;
+    static constexpr unsigned int Size = Chunk::XSize*Chunk::YSize*Chunk::ZSize;
+
+    enum class Channel { BLOCK, SKY };
+
+    ChunkLight() {
+        block.fill(0);
+        sky.fill(0);
+    }
+
+    int get(Channel channel, unsigned int offset) const {
+        const Nibbles &nibbles = channel == Channel::BLOCK ? block : sky;
+        return (nibbles[offset >> 1] >> ((offset & 1)*4)) & 0xf;
+    }
+
+    void set(Channel channel, unsigned int offset, int level) {
+        Nibbles &nibbles = channel == Channel::BLOCK ? block : sky;
+        const int shift = (offset & 1)*4;
+        uint8_t &byte = nibbles[offset >> 1];
+        byte = (byte & ~(0xf << shift)) | (level << shift);
+    }
+
+    int getBlockLight(const ChunkIndex &index) const {
+        return get(Channel::BLOCK, index.getOffset());
+    }
+
+    int getSkyLight(const ChunkIndex &index) const {
+        return get(Channel::SKY, index.getOffset());
+    }
+
+private:
+    using Nibbles = std::array<uint8_t, Size/2>;
+    Nibbles block;
+    Nibbles sky;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "ChunkNeighborhood.h"
+#include <cassert>
+
+namespace {
+// diagonal_offsets in order of their index in a 3x3x3 cube, with the
+// face neighbours and the chunk itself left out
+std::array<glm::ivec3, ChunkNeighborhood::DiagonalCount> makeDiagonalOffsets() {
+    std::array<glm::ivec3, ChunkNeighborhood::DiagonalCount> offsets;
+    int i = 0;
+    for (int z = -1; z <= 1; z++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                if ((x != 0) + (y != 0) + (z != 0) >= 2) {
+                    offsets[i++] = glm::ivec3{x, y, z};
+                }
+            }
+        }
+    }
+    return offsets;
+}
+
+// Index into diagonals by cube index, or -1
+std::array<int, 27> makeDiagonalIndices() {
+    std::array<int, 27> indices;
+    indices.fill(-1);
+    const auto offsets = makeDiagonalOffsets();
+    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+        const glm::ivec3 &offset = offsets[i];
+        indices[(offset.x + 1) + 3*((offset.y + 1) + 3*(offset.z + 1))] = i;
+    }
+    return indices;
+}
+
+const std::array<int, 27> diagonal_indices = makeDiagonalIndices();
+}
+
+constexpr int ChunkNeighborhood::DiagonalCount;
+const std::array<glm::ivec3, ChunkNeighborhood::DiagonalCount>
+ChunkNeighborhood::diagonal_offsets = makeDiagonalOffsets();
+
+const std::shared_ptr<const Chunk> &ChunkNeighborhood::getAdjacent(const glm::ivec3 &offset) const {
+    return const_cast<ChunkNeighborhood &>(*this).getAdjacent(offset);
+}
+
+std::shared_ptr<const Chunk> &ChunkNeighborhood::getAdjacent(const glm::ivec3 &offset) {
+    assert(offset.x >= -1 && offset.x <= 1 && offset.y >= -1 && offset.y <= 1 &&
+           offset.z >= -1 && offset.z <= 1);
+    if (offset == glm::ivec3{0, 0, 0}) {
+        return chunk;
+    }
+    if (auto face = sharedFace(glm::ivec3{0, 0, 0}, offset)) {
+        return neighbors[*face];
+    }
+    return diagonals[diagonal_indices[(offset.x + 1) + 3*((offset.y + 1) + 3*(offset.z + 1))]];
+}
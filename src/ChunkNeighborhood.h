@@ -0,0 +1,29 @@
+#ifndef CHUNKNEIGHBORHOOD_H
+#define CHUNKNEIGHBORHOOD_H
+
+#include "Chunk.h"
+#include "util/Face.h"
+
+#include <array>
+#include <memory>
+
+// A snapshot of a chunk along with the chunks around it, any of which may
+// be missing. Meshing looks into the neighbours across each face to cull
+// the faces on the chunk's border, and into those across the edges and
+// corners too for the ambient occlusion of the blocks along them.
+struct ChunkNeighborhood {
+    std::shared_ptr<const Chunk> chunk;
+    FaceMap<std::shared_ptr<const Chunk>> neighbors;
+    // The chunks at diagonal_offsets, those with two or three components
+    // nonzero
+    static constexpr int DiagonalCount = 20;
+    static const std::array<glm::ivec3, DiagonalCount> diagonal_offsets;
+    std::array<std::shared_ptr<const Chunk>, DiagonalCount> diagonals;
+
+    // The chunk at offset from this one, with every component of offset
+    // -1, 0 or 1
+    const std::shared_ptr<const Chunk> &getAdjacent(const glm::ivec3 &offset) const;
+    std::shared_ptr<const Chunk> &getAdjacent(const glm::ivec3 &offset);
+};
+
+#endif
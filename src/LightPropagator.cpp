@@ -0,0 +1,354 @@
+#include "LightPropagator.h"
+#include <algorithm>
+#include <tuple>
+#include <cassert>
+
+static_assert(Chunk::XSize == 32 &&
+              Chunk::YSize == 32 &&
+              Chunk::ZSize == 32, "Chunk must be 32x32x32");
+
+constexpr int LightPropagator::NoSlot;
+constexpr int LightPropagator::UnknownSlot;
+
+// By face, in the order of Face: where the face's axis sits in a block
+// offset (see ChunkIndex::getOffset), the coordinate along it of the
+// blocks on the face, and the offset of the block across it
+static const int face_shifts[] = { 10, 10, 5, 5, 0, 0 };
+static const unsigned int face_edges[] = { 31, 0, 31, 0, 31, 0 };
+static const int face_steps[] = { 1 << 10, -(1 << 10), 1 << 5, -(1 << 5), 1, -1 };
+
+// The offset of block i, j of the layer at coord along the axis at shift
+static unsigned int layerOffset(int shift, unsigned int coord, unsigned int i, unsigned int j) {
+    switch (shift) {
+    case 10:
+        return (coord << 10) | (i << 5) | j;
+    case 5:
+        return (i << 10) | (coord << 5) | j;
+    default:
+        return (i << 10) | (j << 5) | coord;
+    }
+}
+
+LightPropagator::LightPropagator() :
+    grid(nullptr),
+    blocktypes(nullptr),
+    visits(0) { }
+
+void LightPropagator::reset(const ChunkGrid &grid) {
+    this->grid = &grid;
+    slots.clear();
+    slot_index.clear();
+    for (Channel channel : {Channel::BLOCK, Channel::SKY}) {
+        additions[static_cast<int>(channel)].clear();
+        removals[static_cast<int>(channel)].clear();
+    }
+    visits = 0;
+}
+
+void LightPropagator::updateTypes(const BlockTypeRegistry &types) {
+    blocktypes = &types;
+    opaque.resize(types.getTypeCount());
+    emission.resize(types.getTypeCount());
+    for (unsigned int id = 0; id < types.getTypeCount(); id++) {
+        const BlockType &type = types.getType(id);
+        opaque[id] = type.solid;
+        emission[id] = std::min(type.light, static_cast<unsigned int>(ChunkLight::MaxLevel));
+    }
+}
+
+int LightPropagator::findSlot(const glm::ivec3 &pos) {
+    auto iter = slot_index.find(pos);
+    if (iter != slot_index.end()) {
+        return iter->second;
+    }
+
+    auto chunk = grid->getChunk(pos);
+    if (!chunk) {
+        slot_index.emplace(pos, NoSlot);
+        return NoSlot;
+    }
+
+    const BlockTypeRegistry &types = chunk->getBlockTypes();
+    if (&types != blocktypes || types.getTypeCount() != opaque.size()) {
+        updateTypes(types);
+    }
+
+    const int index = slots.size();
+    assert(index < (1 << (32 - OffsetBits)));
+    slots.emplace_back();
+    Slot &slot = slots.back();
+    slot.pos = pos;
+    slot.light = grid->getLight(pos);
+    if (slot.light) {
+        slot.ids = chunk->getBlockIDs(0);
+        slot.current = slot.light.get();
+    }
+    slot.chunk = std::move(chunk);
+    slot.neighbors.fill(UnknownSlot);
+    slot_index.emplace(pos, index);
+    return index;
+}
+
+int LightPropagator::getNeighbor(int slot, Face face) {
+    int &neighbor = slots[slot].neighbors[static_cast<int>(face)];
+    if (neighbor == UnknownSlot) {
+        // findSlot may move the slots
+        const int found = findSlot(adjacentPos(slots[slot].pos, face));
+        slots[slot].neighbors[static_cast<int>(face)] = found;
+        return found != NoSlot && slots[found].ids ? found : NoSlot;
+    }
+    return neighbor != NoSlot && slots[neighbor].ids ? neighbor : NoSlot;
+}
+
+bool LightPropagator::step(Node node, Face face, Node &next) {
+    const int f = static_cast<int>(face);
+    const unsigned int offset = getOffset(node);
+    if (((offset >> face_shifts[f]) & 31) != face_edges[f]) {
+        next = node + face_steps[f];
+        return true;
+    }
+
+    const int neighbor = getNeighbor(getSlot(node), face);
+    if (neighbor == NoSlot) {
+        return false;
+    }
+    next = makeNode(neighbor, offset ^ (31u << face_shifts[f]));
+    return true;
+}
+
+void LightPropagator::setLevel(Channel channel, Node node, int level) {
+    Slot &slot = slots[getSlot(node)];
+    if (!slot.written) {
+        slot.written = std::make_shared<ChunkLight>(*slot.current);
+        slot.current = slot.written.get();
+    }
+    slot.written->set(channel, getOffset(node), level);
+}
+
+void LightPropagator::add(Channel channel, Node node, int level) {
+    if (getLevel(channel, node) < level) {
+        setLevel(channel, node, level);
+        additions[static_cast<int>(channel)].push_back(node);
+    }
+}
+
+void LightPropagator::remove(Channel channel, Node node) {
+    const int level = getLevel(channel, node);
+    if (level > 0) {
+        setLevel(channel, node, 0);
+        removals[static_cast<int>(channel)].push_back({node, level});
+    }
+}
+
+void LightPropagator::lightChunk(const glm::ivec3 &pos) {
+    const int index = findSlot(pos);
+    if (index == NoSlot) {
+        return;
+    }
+
+    {
+        Slot &slot = slots[index];
+        slot.written = std::make_shared<ChunkLight>();
+        slot.current = slot.written.get();
+        slot.ids = slot.chunk->getBlockIDs(0);
+    }
+
+    // The top of the chunk below was open sky until now
+    const int below = getNeighbor(index, Face::BOTTOM);
+    if (below != NoSlot) {
+        for (unsigned int x = 0; x < Chunk::XSize; x++) {
+            for (unsigned int y = 0; y < Chunk::YSize; y++) {
+                remove(Channel::SKY, makeNode(below, layerOffset(0, Chunk::ZSize-1, x, y)));
+            }
+        }
+    }
+
+    if (getNeighbor(index, Face::TOP) == NoSlot) {
+        for (unsigned int x = 0; x < Chunk::XSize; x++) {
+            for (unsigned int y = 0; y < Chunk::YSize; y++) {
+                for (int z = Chunk::ZSize-1; z >= 0; z--) {
+                    const Node node = makeNode(index, layerOffset(0, z, x, y));
+                    if (isOpaque(node)) {
+                        break;
+                    }
+                    add(Channel::SKY, node, ChunkLight::MaxLevel);
+                }
+            }
+        }
+    }
+
+    for (unsigned int offset = 0; offset < ChunkLight::Size; offset++) {
+        const Node node = makeNode(index, offset);
+        if (const int level = getEmission(node)) {
+            add(Channel::BLOCK, node, level);
+        }
+    }
+
+    // Spread the neighbours' light in from their sides facing this chunk
+    for (Face face : all_faces) {
+        const int neighbor = getNeighbor(index, face);
+        if (neighbor == NoSlot) {
+            continue;
+        }
+
+        const int f = static_cast<int>(oppositeFace(face));
+        for (unsigned int i = 0; i < 32; i++) {
+            for (unsigned int j = 0; j < 32; j++) {
+                const Node node = makeNode(
+                    neighbor, layerOffset(face_shifts[f], face_edges[f], i, j));
+                for (Channel channel : {Channel::BLOCK, Channel::SKY}) {
+                    if (getLevel(channel, node) > 1) {
+                        additions[static_cast<int>(channel)].push_back(node);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightPropagator::updateBlock(const glm::ivec3 &pos) {
+    glm::ivec3 chunkpos, blockpos;
+    std::tie(chunkpos, blockpos) = ChunkGrid::posToChunkBlock(pos);
+    const int index = findSlot(chunkpos);
+    if (index == NoSlot || !slots[index].ids) {
+        return;
+    }
+
+    // Take back the light the block had, and let the light around it back
+    // in if it lets light through
+    const Node node = makeNode(index, ChunkIndex{blockpos}.getOffset());
+    const bool opaque = isOpaque(node);
+    for (Channel channel : {Channel::BLOCK, Channel::SKY}) {
+        remove(channel, node);
+        if (opaque) {
+            continue;
+        }
+
+        for (Face face : all_faces) {
+            Node next;
+            if (step(node, face, next)) {
+                additions[static_cast<int>(channel)].push_back(next);
+            } else if (channel == Channel::SKY && face == Face::TOP) {
+                // Open sky
+                add(channel, node, ChunkLight::MaxLevel);
+            }
+        }
+    }
+
+    if (const int level = getEmission(node)) {
+        add(Channel::BLOCK, node, level);
+    }
+}
+
+void LightPropagator::propagate() {
+    for (Channel channel : {Channel::BLOCK, Channel::SKY}) {
+        propagateRemovals(channel);
+        propagateAdditions(channel);
+    }
+}
+
+void LightPropagator::propagateRemovals(Channel channel) {
+    auto &queue = removals[static_cast<int>(channel)];
+    for (size_t i = 0; i < queue.size(); i++) {
+        const Removal removal = queue[i];
+        visits++;
+        for (Face face : all_faces) {
+            Node next;
+            if (!step(removal.node, face, next)) {
+                continue;
+            }
+
+            const int level = getLevel(channel, next);
+            if (level == 0) {
+                continue;
+            }
+
+            // Full sky light below full sky light came from it
+            const bool sunlit = channel == Channel::SKY && face == Face::BOTTOM &&
+                level == ChunkLight::MaxLevel && removal.level == ChunkLight::MaxLevel;
+            if (level < removal.level || sunlit) {
+                setLevel(channel, next, 0);
+                queue.push_back({next, level});
+                if (channel == Channel::BLOCK) {
+                    add(channel, next, getEmission(next));
+                }
+            } else {
+                // Lit from elsewhere, so it relights the dark patch
+                additions[static_cast<int>(channel)].push_back(next);
+            }
+        }
+    }
+    queue.clear();
+}
+
+void LightPropagator::propagateAdditions(Channel channel) {
+    auto &queue = additions[static_cast<int>(channel)];
+    for (size_t i = 0; i < queue.size(); i++) {
+        const Node node = queue[i];
+        visits++;
+        const int level = getLevel(channel, node);
+        if (level <= 1) {
+            continue;
+        }
+
+        for (Face face : all_faces) {
+            Node next;
+            if (!step(node, face, next) || isOpaque(next)) {
+                continue;
+            }
+
+            const bool sunlit = channel == Channel::SKY && face == Face::BOTTOM &&
+                level == ChunkLight::MaxLevel;
+            const int spread = sunlit ? level : level - 1;
+            if (getLevel(channel, next) < spread) {
+                setLevel(channel, next, spread);
+                queue.push_back(next);
+            }
+        }
+    }
+    queue.clear();
+}
+
+bool LightPropagator::placeBlock(ChunkGrid &grid, const glm::ivec3 &pos, const Block &block) {
+    glm::ivec3 chunkpos, blockpos;
+    std::tie(chunkpos, blockpos) = ChunkGrid::posToChunkBlock(pos);
+    auto chunk = grid.getChunk(chunkpos);
+    if (!chunk) {
+        return false;
+    }
+
+    std::shared_ptr<Chunk> newchunk{new Chunk(*chunk)};
+    newchunk->setBlock(ChunkIndex{blockpos}, block);
+    grid.setChunk(chunkpos, std::move(newchunk));
+    return true;
+}
+
+void LightPropagator::relightBlocks(ChunkGrid &grid, const std::vector<glm::ivec3> &positions) {
+    reset(grid);
+    for (const glm::ivec3 &pos : positions) {
+        updateBlock(pos);
+    }
+    propagate();
+    for (auto &item : takeLight()) {
+        grid.setLight(item.first, std::move(item.second));
+    }
+}
+
+void LightPropagator::setBlock(ChunkGrid &grid, const glm::ivec3 &pos, const Block &block) {
+    if (placeBlock(grid, pos, block)) {
+        relightBlocks(grid, {pos});
+    }
+}
+
+std::vector<std::pair<glm::ivec3, std::shared_ptr<const ChunkLight>>>
+LightPropagator::takeLight() {
+    std::vector<std::pair<glm::ivec3, std::shared_ptr<const ChunkLight>>> light;
+    for (Slot &slot : slots) {
+        if (slot.written) {
+            light.emplace_back(slot.pos, std::move(slot.written));
+            slot.current = nullptr;
+            slot.ids = nullptr;
+        }
+    }
+    return light;
+}
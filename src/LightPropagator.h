@@ -0,0 +1,133 @@
+#ifndef LIGHTPROPAGATOR_H
+#define LIGHTPROPAGATOR_H
+
+#include "ChunkGrid.h"
+#include "ChunkLight.h"
+#include "BlockTypeRegistry.h"
+
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <cstdint>
+
+// Spreads light through the chunks of a ChunkGrid, breadth first, across
+// chunk borders. Light drops a level per block, and doesn't enter solid
+// blocks. Sky light at full strength goes straight down without dropping,
+// from the top of any chunk without a lit chunk above it.
+//
+// Changes are queued up, then propagated together. Removals go first,
+// darkening whatever the removed light reached and relighting the edges
+// of the dark patch from the light left around it, so that an edit only
+// costs in proportion to the light it affects. Chunks are only read from
+// the grid; their light is copied on first write, and handed back by
+// takeLight to be put in the grid, so that the grid can be a snapshot
+// being lit on a worker.
+class LightPropagator {
+public:
+    using Channel = ChunkLight::Channel;
+
+    LightPropagator();
+
+    // Starts over on grid, which must outlive the propagation, with
+    // nothing queued and nothing written
+    void reset(const ChunkGrid &grid);
+
+    // Queues lighting the unlit chunk at pos from scratch: its open sky,
+    // its glowing blocks, and the light coming in from its lit
+    // neighbours. If it sits on a lit chunk, that chunk's light from the
+    // open sky is taken back. Chunks stacked in a column are cheapest lit
+    // from the top down.
+    void lightChunk(const glm::ivec3 &pos);
+    // Queues relighting around the block at pos, whose chunk in the grid
+    // already has the new block. Blocks in unlit chunks are skipped.
+    void updateBlock(const glm::ivec3 &pos);
+
+    void propagate();
+
+    // Sets the block at pos in grid, replacing its chunk with a copy so
+    // that snapshots of the grid keep the old one. False if the chunk is
+    // missing.
+    static bool placeBlock(ChunkGrid &grid, const glm::ivec3 &pos, const Block &block);
+    // Starts over on grid, relights around the blocks at positions,
+    // already placed, and puts the new light in the grid
+    void relightBlocks(ChunkGrid &grid, const std::vector<glm::ivec3> &positions);
+    // Both of the above, for a single edit
+    void setBlock(ChunkGrid &grid, const glm::ivec3 &pos, const Block &block);
+
+    // The chunks whose light was written, with their new light, leaving
+    // the propagator to be reset
+    std::vector<std::pair<glm::ivec3, std::shared_ptr<const ChunkLight>>> takeLight();
+
+    // Blocks visited by propagate, removals included, since the last reset
+    unsigned long getVisitCount() const { return visits; }
+
+private:
+    static constexpr int NoSlot = -1;
+    static constexpr int UnknownSlot = -2;
+
+    // A chunk of the grid taking part, looked up as propagation reaches it
+    struct Slot {
+        glm::ivec3 pos;
+        std::shared_ptr<const Chunk> chunk;
+        std::shared_ptr<const ChunkLight> light;
+        std::shared_ptr<ChunkLight> written;
+        // Null if the chunk is missing or unlit, which light doesn't enter
+        const BlockType::ID *ids = nullptr;
+        const ChunkLight *current = nullptr;
+        std::array<int, 6> neighbors;
+    };
+
+    // Blocks are queued as nodes, their slot above the bits of their
+    // offset in the chunk
+    using Node = uint32_t;
+    static constexpr int OffsetBits = 15;
+
+    struct Removal {
+        Node node;
+        int level;
+    };
+
+    const ChunkGrid *grid;
+    const BlockTypeRegistry *blocktypes;
+    std::vector<Slot> slots;
+    std::unordered_map<glm::ivec3, int> slot_index;
+    // By block ID
+    std::vector<uint8_t> opaque;
+    std::vector<uint8_t> emission;
+    std::array<std::vector<Node>, 2> additions;
+    std::array<std::vector<Removal>, 2> removals;
+    unsigned long visits;
+
+    void updateTypes(const BlockTypeRegistry &types);
+    int findSlot(const glm::ivec3 &pos);
+    int getNeighbor(int slot, Face face);
+    // Sets next to the block across face from node, and false if it's in
+    // a missing or unlit chunk
+    bool step(Node node, Face face, Node &next);
+
+    static int getSlot(Node node) { return node >> OffsetBits; }
+    static unsigned int getOffset(Node node) { return node & ((1 << OffsetBits) - 1); }
+    static Node makeNode(int slot, unsigned int offset) {
+        return (static_cast<Node>(slot) << OffsetBits) | offset;
+    }
+
+    bool isOpaque(Node node) const {
+        return opaque[slots[getSlot(node)].ids[getOffset(node)]];
+    }
+    int getEmission(Node node) const {
+        return emission[slots[getSlot(node)].ids[getOffset(node)]];
+    }
+    int getLevel(Channel channel, Node node) const {
+        return slots[getSlot(node)].current->get(channel, getOffset(node));
+    }
+    void setLevel(Channel channel, Node node, int level);
+
+    void add(Channel channel, Node node, int level);
+    void remove(Channel channel, Node node);
+    void propagateRemovals(Channel channel);
+    void propagateAdditions(Channel channel);
+};
+
+#endif
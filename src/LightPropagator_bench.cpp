@@ -0,0 +1,151 @@
+#include "LightPropagator.h"
+#include "TestWorldGenerator.h"
+#include "World.h"
+#include "util/Benchmark.h"
+#include "util/SampleWindow.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// A region of generated chunk columns, the size of one of World's light
+// jobs, as high as the game generates them
+namespace {
+struct RegionFixture {
+    static constexpr int Size = World::LightRegionSize;
+
+    BlockTypeRegistry types;
+    ChunkGrid grid;
+    // Top down, as World lights them
+    std::vector<glm::ivec3> chunks;
+
+    RegionFixture() {
+        TestWorldGenerator::makeBlockTypes(types);
+
+        TestWorldGenerator gen;
+        gen.reseed(1);
+        for (int z = 1; z >= -2; z--) {
+            for (int x = 0; x < Size; x++) {
+                for (int y = 0; y < Size; y++) {
+                    chunks.emplace_back(x, y, z);
+                    grid.setChunk(chunks.back(), gen.generateChunk(chunks.back(), types));
+                }
+            }
+        }
+    }
+
+    void light() {
+        LightPropagator light;
+        light.reset(grid);
+        for (const glm::ivec3 &pos : chunks) {
+            light.lightChunk(pos);
+        }
+        light.propagate();
+        for (auto &item : light.takeLight()) {
+            grid.setLight(item.first, std::move(item.second));
+        }
+    }
+
+    // The top solid block of columns away from the region's edges
+    std::vector<glm::ivec3> findSurface(int count) const {
+        std::mt19937 rand{1};
+        std::uniform_int_distribution<int> xy{Chunk::XSize, (Size-1)*Chunk::XSize - 1};
+        std::vector<glm::ivec3> surface;
+        while (static_cast<int>(surface.size()) < count) {
+            glm::ivec3 pos{xy(rand), xy(rand), 2*Chunk::ZSize - 1};
+            for (; pos.z >= -2*Chunk::ZSize; pos.z--) {
+                if (grid.findBlock(pos)->getType().solid) {
+                    surface.push_back(pos);
+                    break;
+                }
+            }
+        }
+        return surface;
+    }
+};
+}
+
+// Lights the region from scratch, as a light job does, leaving the grid
+// unlit for the next pass
+BENCHMARK(LightPropagator, LightGeneratedRegion) {
+    RegionFixture fixture;
+    LightPropagator light;
+    double visits = 0, chunks = 0;
+    while (state.keepRunning()) {
+        light.reset(fixture.grid);
+        for (const glm::ivec3 &pos : fixture.chunks) {
+            light.lightChunk(pos);
+        }
+        light.propagate();
+        visits += light.getVisitCount();
+        chunks += fixture.chunks.size();
+        light.takeLight();
+        state.addItems(fixture.chunks.size());
+    }
+
+    state.setCounter("us/chunk", 1e6 * state.getSeconds() / chunks);
+    state.setCounter("visits/chunk", visits / chunks);
+}
+
+// Edits the blocks at positions one at a time, a pass each, setting each
+// to first then back to second, and reports the latency of single edits,
+// the chunk copy included
+static void benchEdits(BenchmarkState &state,
+                       RegionFixture &fixture,
+                       const std::vector<glm::ivec3> &positions,
+                       const Block &first, const Block &second) {
+    LightPropagator light;
+    SampleWindow latency{4096};
+    double visits = 0;
+    size_t i = 0;
+    while (state.keepRunning()) {
+        const glm::ivec3 &pos = positions[(i/2) % positions.size()];
+        const auto start = BenchmarkState::Clock::now();
+        light.setBlock(fixture.grid, pos, i % 2 ? second : first);
+        const std::chrono::duration<float, std::micro> time =
+            BenchmarkState::Clock::now() - start;
+        latency.add(time.count());
+        visits += light.getVisitCount();
+        state.addItems(1);
+        i++;
+    }
+
+    state.setCounter("us p50", latency.getPercentile(.5));
+    state.setCounter("us p99", latency.getPercentile(.99));
+    state.setCounter("us max", latency.getMax());
+    state.setCounter("visits/edit", visits / i);
+}
+
+// Digs out surface blocks and puts them back, letting the sky down into
+// the hole and taking it back
+BENCHMARK(LightPropagator, UpdateDigSurface) {
+    RegionFixture fixture;
+    fixture.light();
+    const auto surface = fixture.findSurface(256);
+    benchEdits(state, fixture, surface,
+               fixture.types.getType("air"), fixture.types.getType("stone"));
+}
+
+// Sets down and takes away a lamp on the surface, which lights and
+// darkens a 14 block radius
+BENCHMARK(LightPropagator, UpdateLampOnSurface) {
+    RegionFixture fixture;
+    fixture.light();
+    auto above = fixture.findSurface(256);
+    for (glm::ivec3 &pos : above) {
+        pos.z++;
+    }
+    benchEdits(state, fixture, above,
+               fixture.types.getType("lamp"), fixture.types.getType("air"));
+}
+
+// Digs out and fills in blocks deep underground, where there's no light
+BENCHMARK(LightPropagator, UpdateDigBuried) {
+    RegionFixture fixture;
+    fixture.light();
+    auto buried = fixture.findSurface(256);
+    for (glm::ivec3 &pos : buried) {
+        pos.z = -2*Chunk::ZSize;
+    }
+    benchEdits(state, fixture, buried,
+               fixture.types.getType("air"), fixture.types.getType("stone"));
+}
@@ -0,0 +1,182 @@
+#include "LightPropagator.h"
+#include "TestWorldGenerator.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+namespace {
+struct LightFixture {
+    BlockTypeRegistry types;
+    ChunkGrid grid;
+    LightPropagator light;
+
+    LightFixture() {
+        TestWorldGenerator::makeBlockTypes(types);
+    }
+
+    void addChunk(const glm::ivec3 &pos, const std::string &fill) {
+        std::shared_ptr<Chunk> chunk{new Chunk{types}};
+        chunk->fill(types.getType(fill));
+        grid.setChunk(pos, std::move(chunk));
+    }
+
+    // Lights the given chunks together, top down
+    void lightChunks(std::vector<glm::ivec3> chunks) {
+        std::sort(chunks.begin(), chunks.end(),
+                  [](const glm::ivec3 &a, const glm::ivec3 &b) { return a.z > b.z; });
+        light.reset(grid);
+        for (const glm::ivec3 &pos : chunks) {
+            light.lightChunk(pos);
+        }
+        light.propagate();
+        apply();
+    }
+
+    // Sets all the blocks, then relights them together
+    void setBlocks(const std::vector<std::pair<glm::ivec3, std::string>> &blocks) {
+        std::vector<glm::ivec3> positions;
+        for (const auto &block : blocks) {
+            LightPropagator::placeBlock(grid, block.first, types.getType(block.second));
+            positions.push_back(block.first);
+        }
+        light.relightBlocks(grid, positions);
+    }
+
+    void setBlock(const glm::ivec3 &pos, const std::string &type) {
+        setBlocks({{pos, type}});
+    }
+
+    void apply() {
+        for (auto &item : light.takeLight()) {
+            grid.setLight(item.first, std::move(item.second));
+        }
+    }
+
+    int getLight(ChunkLight::Channel channel, const glm::ivec3 &pos) const {
+        glm::ivec3 chunkpos, blockpos;
+        std::tie(chunkpos, blockpos) = ChunkGrid::posToChunkBlock(pos);
+        return grid.getLight(chunkpos)->get(channel, ChunkIndex{blockpos}.getOffset());
+    }
+
+    int getBlockLight(const glm::ivec3 &pos) const {
+        return getLight(ChunkLight::Channel::BLOCK, pos);
+    }
+
+    int getSkyLight(const glm::ivec3 &pos) const {
+        return getLight(ChunkLight::Channel::SKY, pos);
+    }
+};
+}
+
+TEST(LightPropagator, SkyLightsOpenColumns) {
+    LightFixture f;
+    f.addChunk({0, 0, 0}, "air");
+    f.addChunk({0, 0, -1}, "stone");
+    f.lightChunks({{0, 0, 0}, {0, 0, -1}});
+    f.setBlock({5, 5, 10}, "stone");
+
+    EXPECT_EQ(15, f.getSkyLight({5, 5, 31}));
+    EXPECT_EQ(15, f.getSkyLight({5, 5, 11}));
+    EXPECT_EQ(0, f.getSkyLight({5, 5, 10}));
+    // Lit from the side, not from above
+    EXPECT_EQ(14, f.getSkyLight({5, 5, 9}));
+    EXPECT_EQ(15, f.getSkyLight({6, 5, 9}));
+    EXPECT_EQ(0, f.getSkyLight({5, 5, -1}));
+}
+
+TEST(LightPropagator, BlockLightCrossesChunks) {
+    LightFixture f;
+    f.addChunk({0, 0, 0}, "air");
+    f.addChunk({1, 0, 0}, "air");
+    f.addChunk({0, 0, 1}, "stone");
+    f.addChunk({1, 0, 1}, "stone");
+    f.lightChunks({{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, 0, 1}});
+    EXPECT_EQ(0, f.getSkyLight({5, 5, 5}));
+
+    f.setBlock({30, 5, 5}, "lamp");
+    EXPECT_EQ(14, f.getBlockLight({30, 5, 5}));
+    EXPECT_EQ(13, f.getBlockLight({31, 5, 5}));
+    EXPECT_EQ(11, f.getBlockLight({33, 5, 5}));
+    EXPECT_EQ(10, f.getBlockLight({33, 6, 5}));
+    EXPECT_EQ(0, f.getBlockLight({44, 5, 5}));
+
+    f.setBlock({32, 5, 5}, "stone");
+    EXPECT_EQ(0, f.getBlockLight({32, 5, 5}));
+    EXPECT_EQ(9, f.getBlockLight({33, 5, 5}));
+
+    f.setBlock({30, 5, 5}, "air");
+    for (int x = 20; x < 44; x++) {
+        EXPECT_EQ(0, f.getBlockLight({x, 5, 5}));
+    }
+}
+
+TEST(LightPropagator, ChunkAboveTakesBackSky) {
+    LightFixture f;
+    f.addChunk({0, 0, 0}, "air");
+    f.lightChunks({{0, 0, 0}});
+    EXPECT_EQ(15, f.getSkyLight({5, 5, 0}));
+
+    f.addChunk({0, 0, 1}, "stone");
+    f.lightChunks({{0, 0, 1}});
+    EXPECT_EQ(0, f.getSkyLight({5, 5, 0}));
+    EXPECT_EQ(0, f.getSkyLight({5, 5, 31}));
+}
+
+// Makes random edits to generated ground, relit batch_size at a time,
+// and checks it ends up just as if lit from scratch
+static void checkUpdates(int batch_size) {
+    static const char *edit_types[] = {"air", "stone", "lamp", "tall_grass"};
+
+    LightFixture f;
+    TestWorldGenerator gen;
+    gen.reseed(7);
+    std::vector<glm::ivec3> chunks;
+    for (int x = 0; x < 2; x++) {
+        for (int y = 0; y < 2; y++) {
+            for (int z = -1; z < 1; z++) {
+                chunks.emplace_back(x, y, z);
+                f.grid.setChunk(chunks.back(), gen.generateChunk(chunks.back(), f.types));
+            }
+        }
+    }
+    f.lightChunks(chunks);
+
+    std::mt19937 rand{42};
+    std::uniform_int_distribution<int> xy{0, 63};
+    std::uniform_int_distribution<int> z{-20, 20};
+    std::uniform_int_distribution<int> type{0, 3};
+    for (int i = 0; i < 200; i += batch_size) {
+        std::vector<std::pair<glm::ivec3, std::string>> edits;
+        for (int j = 0; j < batch_size; j++) {
+            edits.emplace_back(glm::ivec3{xy(rand), xy(rand), z(rand)}, edit_types[type(rand)]);
+        }
+        f.setBlocks(edits);
+    }
+
+    LightFixture scratch;
+    for (const glm::ivec3 &pos : chunks) {
+        scratch.grid.setChunk(pos, std::shared_ptr<Chunk>{new Chunk{*f.grid.getChunk(pos)}});
+    }
+    scratch.lightChunks(chunks);
+
+    for (const glm::ivec3 &pos : chunks) {
+        const ChunkLight &updated = *f.grid.getLight(pos);
+        const ChunkLight &expected = *scratch.grid.getLight(pos);
+        for (unsigned int offset = 0; offset < ChunkLight::Size; offset++) {
+            for (auto channel : {ChunkLight::Channel::BLOCK, ChunkLight::Channel::SKY}) {
+                ASSERT_EQ(expected.get(channel, offset), updated.get(channel, offset))
+                    << "chunk " << pos.x << ' ' << pos.y << ' ' << pos.z
+                    << " offset " << offset;
+            }
+        }
+    }
+}
+
+TEST(LightPropagator, UpdatesMatchLightingFromScratch) {
+    checkUpdates(1);
+}
+
+TEST(LightPropagator, BatchedUpdatesMatchLightingFromScratch) {
+    checkUpdates(20);
+}
@@ -0,0 +1,80 @@
+#include "TestWorldGenerator.h"
+#include "perlin.h"
+
+bool TestWorldGenerator::solid(glm::vec3 pos) const {
+    float val = 2*perlin3(pos, seed);
+
+    glm::vec3 threshpos{pos.x/20, pos.y/20, 0};
+    float thresh = pos.z + 5*perlin3(threshpos, seed ^ 0x1);
+
+    return val > thresh;
+}
+
+void TestWorldGenerator::makeBlockTypes(BlockTypeRegistry &types) {
+    BlockTypeInfo air;
+    air.solid = false;
+    types.makeType("air", air);
+    types.makeType("stone", BlockTypeInfo{});
+    types.makeType("dirt", BlockTypeInfo{});
+    types.makeType("grass", BlockTypeInfo{});
+    BlockTypeInfo tall_grass;
+    tall_grass.solid = false;
+    types.makeType("tall_grass", tall_grass);
+    BlockTypeInfo lamp;
+    lamp.light = 14;
+    types.makeType("lamp", lamp);
+}
+
+std::unique_ptr<Chunk> TestWorldGenerator::generateChunk(
+    const glm::ivec3 &chunkpos,
+    const BlockTypeRegistry &blocktypes) const
+{
+    const auto &air = blocktypes.getType("air");
+    const auto &grass = blocktypes.getType("grass");
+    const auto &dirt = blocktypes.getType("dirt");
+    const auto &stone = blocktypes.getType("stone");
+    const auto &tall_grass = blocktypes.getType("tall_grass");
+
+    std::unique_ptr<Chunk> chunk{new Chunk{blocktypes}};
+    chunk->fill(air);
+
+    for (auto &pos : ChunkIndex::range) {
+        glm::vec3 worldpos = static_cast<glm::vec3>(chunkpos) +
+            static_cast<glm::vec3>(pos.getVec())/32.0f;
+        chunk->setBlock(pos, solid(worldpos) ? stone : air);
+    }
+
+    for (int x=0; x<Chunk::XSize; x++) {
+        for (int y=0; y<Chunk::YSize; y++) {
+            int ctr = 0;
+
+            glm::vec3 pos_above{chunkpos.x + x/32.0f,
+                                chunkpos.y + y/32.0f,
+                                chunkpos.z+1};
+            if (solid(pos_above))
+                continue;
+
+            bool has_tall_grass = perlin3(pos_above, seed ^ 0x02) > 0.2f;
+            
+            for (int z=Chunk::ZSize-1; z>=0; z--) {
+                ChunkIndex idx{x, y, z};
+                auto b = chunk->getBlock(idx);
+                if (b.getType() == stone) {
+                    if (ctr == 0) {
+                        chunk->setBlock(idx, has_tall_grass ? tall_grass : grass);
+                    } else if (ctr == 1) {
+                        chunk->setBlock(idx, has_tall_grass ? grass : dirt);
+                    } else {
+                        chunk->setBlock(idx, dirt);
+                    }
+
+                    if (++ctr >= 4) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return chunk;
+}
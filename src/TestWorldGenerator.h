@@ -0,0 +1,29 @@
+#ifndef TESTWORLDGENERATOR_H
+#define TESTWORLDGENERATOR_H
+
+#include "WorldGenerator.h"
+
+// Perlin noise hills, covered in grass and the odd patch of tall grass.
+// Expects "air", "stone", "dirt", "grass" and "tall_grass" block types.
+class TestWorldGenerator : public WorldGenerator {
+public:
+    TestWorldGenerator() : seed(0) { }
+
+    bool solid(glm::vec3 pos) const;
+
+    std::unique_ptr<Chunk> generateChunk(
+        const glm::ivec3 &chunkpos,
+        const BlockTypeRegistry &blocktypes) const;
+
+    void reseed(int seed) { this->seed = seed; }
+
+    // Makes the block types it expects, with their IDs in the order
+    // game.lua makes them, and a "lamp" giving off light, for tests and
+    // benchmarks that run without lua
+    static void makeBlockTypes(BlockTypeRegistry &types);
+
+private:
+    int seed;
+};
+
+#endif
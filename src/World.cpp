@@ -1,4 +1,6 @@
 #include "World.h"
+#include <algorithm>
+#include <unordered_map>
 #include <utility>
 
 World::World(const BlockTypeRegistry &blocktypes,
@@ -6,6 +8,7 @@ World::World(const BlockTypeRegistry &blocktypes,
              ThreadManager &tm) :
     blocktypes(blocktypes),
     chunkgen(chunkgen),
+    light_generation(0),
     tm(tm) { }
 
 void World::asyncGenerateChunk(const glm::ivec3 &pos) {
@@ -18,7 +21,134 @@ void World::asyncGenerateChunk(const glm::ivec3 &pos) {
         tm.postMain([=, chunkptr = std::move(chunkptr)]() {
             grid.setChunk(pos, std::move(chunkptr));
             chunkgen_pending.erase(pos);
+            unlit.insert(pos);
         });
     });
     chunkgen_pending.insert(pos);
 }
+
+void World::clearAllChunks() {
+    grid.clearAllChunks();
+    unlit.clear();
+    light_regions.clear();
+    deferred_edits.clear();
+    light_generation++;
+}
+
+void World::setBlock(const glm::ivec3 &pos, const Block &block) {
+    if (!LightPropagator::placeBlock(grid, pos, block)) {
+        return;
+    }
+
+    deferred_edits.push_back(pos);
+    relightEdits();
+}
+
+void World::relightEdits() {
+    std::vector<glm::ivec3> ready;
+    auto waiting = deferred_edits.begin();
+    for (const glm::ivec3 &pos : deferred_edits) {
+        if (isNearLightJob(ChunkGrid::posToChunkBlock(pos).first)) {
+            *waiting++ = pos;
+        } else {
+            ready.push_back(pos);
+        }
+    }
+    deferred_edits.erase(waiting, deferred_edits.end());
+
+    edit_light.relightBlocks(grid, ready);
+}
+
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+glm::ivec3 World::getLightRegion(const glm::ivec3 &pos) {
+    return {floorDiv(pos.x, LightRegionSize), floorDiv(pos.y, LightRegionSize), 0};
+}
+
+bool World::isNearLightJob(const glm::ivec3 &chunkpos) const {
+    // An edit relights the columns beside its own, and a job reads the
+    // columns beside its region
+    const glm::ivec3 min = getLightRegion(chunkpos - glm::ivec3{2, 2, 0});
+    const glm::ivec3 max = getLightRegion(chunkpos + glm::ivec3{2, 2, 0});
+    for (int x = min.x; x <= max.x; x++) {
+        for (int y = min.y; y <= max.y; y++) {
+            if (light_regions.count(glm::ivec3{x, y, 0})) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool World::isLightRegionFree(const glm::ivec3 &region) const {
+    // Neighbouring regions' jobs write the columns between them
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            if (light_regions.count(region + glm::ivec3{x, y, 0})) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void World::updateLight() {
+    std::unordered_map<glm::ivec3, std::vector<glm::ivec3>> regions;
+    for (const glm::ivec3 &pos : unlit) {
+        const glm::ivec3 region = getLightRegion(pos);
+        if (!light_regions.count(region)) {
+            regions[region].push_back(pos);
+        }
+    }
+
+    for (auto &item : regions) {
+        if (isLightRegionFree(item.first)) {
+            light_regions.insert(item.first);
+            asyncLightRegion(item.first, std::move(item.second));
+        }
+    }
+}
+
+void World::asyncLightRegion(const glm::ivec3 &region, std::vector<glm::ivec3> chunks) {
+    const glm::ivec2 min{region.x*LightRegionSize - 1, region.y*LightRegionSize - 1};
+    const glm::ivec2 max{min.x + LightRegionSize + 1, min.y + LightRegionSize + 1};
+    std::shared_ptr<const ChunkGrid> snapshot{new ChunkGrid{grid.copyColumns(min, max)}};
+
+    // From the top down, so that chunks lit together never take back the
+    // open sky they lit below each other
+    std::sort(chunks.begin(), chunks.end(),
+              [](const glm::ivec3 &a, const glm::ivec3 &b) { return a.z > b.z; });
+
+    const unsigned int generation = light_generation;
+    tm.postWork([=](WorkerThread &wt) {
+        auto &light = wt.cacheLocal<LightPropagator>("LightPropagator");
+        light.reset(*snapshot);
+        for (const glm::ivec3 &pos : chunks) {
+            light.lightChunk(pos);
+        }
+        light.propagate();
+        auto lit = light.takeLight();
+
+        tm.postMain([=, lit = std::move(lit)]() {
+            if (generation != light_generation) {
+                return;
+            }
+
+            light_regions.erase(region);
+            // If not, the chunks stay unlit, for the next updateLight
+            if (grid.matches(*snapshot)) {
+                for (const auto &item : lit) {
+                    grid.setLight(item.first, item.second);
+                }
+                for (const glm::ivec3 &pos : chunks) {
+                    unlit.erase(pos);
+                }
+            }
+            // Edits to the snapshot's blocks since are relit over the
+            // job's light
+            relightEdits();
+        });
+    });
+}
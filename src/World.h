@@ -4,9 +4,11 @@
 #include "ChunkGrid.h"
 #include "Block.h"
 #include "WorldGenerator.h"
+#include "LightPropagator.h"
 #include "util/ThreadManager.h"
 
 #include <unordered_set>
+#include <vector>
 #include <memory>
 
 class World {
@@ -21,13 +23,46 @@ public:
     const BlockTypeRegistry &getBlockTypes() const { return blocktypes; }
     
     void asyncGenerateChunk(const glm::ivec3 &pos);
-    
+    unsigned int getPendingChunkCount() const { return chunkgen_pending.size(); }
+    void clearAllChunks();
+
+    // Replaces the block at pos in a copy of its chunk, and relights
+    // around it right away, unless a light job is reading the light there,
+    // in which case it's relit as soon as the job is done
+    void setBlock(const glm::ivec3 &pos, const Block &block);
+
+    // Chunks are lit on the workers, LightRegionSize by LightRegionSize
+    // columns of chunks to a job, along with a column of neighbours all
+    // round them that light spills into. Neighbouring regions' jobs never
+    // run at once, and edits hold off relighting near a job rather than
+    // make it start over, so that a busy spot can't hold up lighting the
+    // chunks around it. Call once a frame.
+    void updateLight();
+    static constexpr int LightRegionSize = 4;
+    unsigned int getUnlitChunkCount() const { return unlit.size(); }
+    unsigned int getLightJobCount() const { return light_regions.size(); }
+
 private:
     ChunkGrid grid;
     const BlockTypeRegistry &blocktypes;
     const WorldGenerator &chunkgen;
     std::unordered_set<glm::ivec3> chunkgen_pending;
 
+    // Chunks yet to be lit, and the regions being lit, at z=0
+    std::unordered_set<glm::ivec3> unlit;
+    std::unordered_set<glm::ivec3> light_regions;
+    // Bumped by clearAllChunks, to throw away jobs started before
+    unsigned int light_generation;
+    LightPropagator edit_light;
+    // Edits waiting on a light job to be relit
+    std::vector<glm::ivec3> deferred_edits;
+
+    static glm::ivec3 getLightRegion(const glm::ivec3 &pos);
+    bool isLightRegionFree(const glm::ivec3 &region) const;
+    bool isNearLightJob(const glm::ivec3 &chunkpos) const;
+    void relightEdits();
+    void asyncLightRegion(const glm::ivec3 &region, std::vector<glm::ivec3> chunks);
+
     ThreadManager &tm;
 };
 
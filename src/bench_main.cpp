@@ -0,0 +1,30 @@
+#include "util/Benchmark.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+static std::atomic<unsigned long> allocations{0};
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+unsigned long Benchmark::getAllocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+int main(int argc, char **argv) {
+    return Benchmark::runAll(argc, argv);
+}
@@ -5,6 +5,7 @@
 #include "gfx/Mesh.h"
 #include "gfx/TextureArrayBuilder.h"
 #include "Chunk.h"
+#include "ChunkNeighborhood.h"
 #include <memory>
 
 class BlockVisual;
@@ -30,14 +31,21 @@ class BlockVisual {
 public:
     virtual ~BlockVisual() { }
 
-    // TODO don't give entire chunk, instead give adjacent blocks
+    // TODO don't give entire chunks, instead give adjacent blocks
     // and their visuals directly
     virtual void tesselate(MeshBuilder &builder,
                            const BlockVisualRegistry &visuals,
-                           const Chunk &chunk,
+                           const ChunkNeighborhood &neighborhood,
                            const ChunkIndex &pos,
                            const Block &block) const = 0;
     virtual bool isTransparent() const = 0;
+
+    // Plain cubes return their per-face texture layers, which lets
+    // BlockVisualRegistry merge their faces instead of calling tesselate.
+    virtual const FaceMap<unsigned int> *getCubeFaceTexes() const { return nullptr; }
+    // Likewise plants return their texture layer, which lets them be drawn
+    // as instances of one shared mesh instead of calling tesselate.
+    virtual const unsigned int *getPlantTex() const { return nullptr; }
 };
 
 #endif
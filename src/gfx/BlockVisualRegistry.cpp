@@ -1,4 +1,10 @@
 #include "BlockVisualRegistry.h"
+#include "gfx/GreedyMesher.h"
+#include "gfx/ChunkVertex.h"
+#include "gfx/PlantBlockVisual.h"
+#include <algorithm>
+#include <cstring>
+#include <cassert>
 
 BlockVisualRegistry::BlockVisualRegistry(unsigned int block_tex_size) :
     block_tex_builder(block_tex_size, block_tex_size)
@@ -7,9 +13,24 @@ BlockVisualRegistry::BlockVisualRegistry(unsigned int block_tex_size) :
 const BlockVisual &BlockVisualRegistry::makeVisual(BlockType::ID id, const BlockVisualInfo &info) {
     if (id >= visuals.size()) {
         visuals.resize(id+1);
+        entries.resize(id+1);
     }
 
-    return *(visuals[id] = info.buildVisual(block_tex_builder));
+    const BlockVisual &visual = *(visuals[id] = info.buildVisual(block_tex_builder));
+    VisualEntry &entry = entries[id];
+    entry = VisualEntry{};
+    entry.visual = &visual;
+    entry.opaque = !visual.isTransparent();
+    if (const FaceMap<unsigned int> *texes = visual.getCubeFaceTexes()) {
+        entry.model = Model::CUBE;
+        entry.face_layers = *texes;
+    } else if (const unsigned int *tex = visual.getPlantTex()) {
+        entry.model = Model::PLANT;
+        entry.plant_layer = *tex;
+    } else {
+        entry.model = Model::CUSTOM;
+    }
+    return visual;
 }
 
 const BlockVisual *BlockVisualRegistry::getVisual(BlockType::ID id) const {
@@ -24,18 +45,648 @@ bool BlockVisualRegistry::hasVisual(BlockType::ID id) const {
     return getVisual(id) != nullptr;
 }
 
-void BlockVisualRegistry::prepareTesselate() {
+std::vector<uint8_t> BlockVisualRegistry::getFlags(const BlockTypeRegistry &types) const {
+    std::vector<uint8_t> flags(entries.size());
+    for (BlockType::ID id = 0; id < entries.size(); id++) {
+        const VisualEntry &entry = entries[id];
+        uint8_t &flag = flags[id];
+        if (entry.opaque) {
+            flag |= 1 << OPAQUE_BIT;
+        }
+        switch (entry.model) {
+        case Model::CUBE:
+            flag |= 1 << CUBE_BIT;
+            if (types.getType(id).solid) {
+                flag |= 1 << CULLING_BIT;
+            }
+            break;
+        case Model::PLANT:
+            flag |= 1 << PLANT_BIT;
+            break;
+        case Model::CUSTOM:
+            flag |= 1 << CUSTOM_BIT;
+            break;
+        case Model::NONE:
+            break;
+        }
+    }
+    return flags;
+}
+
+const std::vector<uint8_t> &BlockVisualRegistry::findFlags(const BlockTypeRegistry &types,
+                                                           std::vector<uint8_t> &scratch) const {
+    if (&types == flag_types && types.getTypeCount() == flag_type_count) {
+        return cached_flags;
+    }
+    scratch = getFlags(types);
+    return scratch;
+}
+
+void BlockVisualRegistry::prepareTesselate(const BlockTypeRegistry &types) {
     block_tex = block_tex_builder.build();
+    prepareFlags(types);
+}
+
+void BlockVisualRegistry::prepareFlags(const BlockTypeRegistry &types) {
+    cached_flags = getFlags(types);
+    flag_types = &types;
+    flag_type_count = types.getTypeCount();
+}
+
+void BlockVisualRegistry::tesselate(MeshBuilder &builder,
+                                    const ChunkNeighborhood &neighborhood,
+                                    std::vector<PlantInstance> *plants) const {
+    tesselateRange(builder, neighborhood, 0, Chunk::ZSize, plants);
+}
+
+void BlockVisualRegistry::tesselateSection(MeshBuilder &builder,
+                                           const ChunkNeighborhood &neighborhood,
+                                           int section,
+                                           std::vector<PlantInstance> *plants) const {
+    tesselateRange(builder, neighborhood,
+                   section*SectionHeight, (section+1)*SectionHeight, plants);
+}
+
+static PlantInstance makePlantInstance(const ChunkIndex &pos, unsigned int tex) {
+    const glm::ivec3 vec = pos.getVec();
+    assert(tex <= 255);
+    return PlantInstance{static_cast<uint8_t>(vec.x),
+                         static_cast<uint8_t>(vec.y),
+                         static_cast<uint8_t>(vec.z),
+                         static_cast<uint8_t>(tex)};
+}
+
+void BlockVisualRegistry::findPlants(std::vector<PlantInstance> &plants,
+                                     const Chunk &chunk,
+                                     int section) const {
+    plants.clear();
+    const int zmin = section*SectionHeight;
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            const BlockType::ID *ids = chunk.getBlockIDs(ChunkIndex{x, y, zmin}.getOffset());
+            for (int z = 0; z < SectionHeight; z++) {
+                if (ids[z] < entries.size() && entries[ids[z]].model == Model::PLANT) {
+                    plants.push_back(makePlantInstance(ChunkIndex{x, y, zmin + z},
+                                                       entries[ids[z]].plant_layer));
+                }
+            }
+        }
+    }
+}
+
+int BlockVisualRegistry::countLeftOut(const Chunk &chunk, int section) const {
+    if (geometry != ChunkGeometry::FACES) {
+        return 0;
+    }
+
+    int count = 0;
+    const int zmin = section*SectionHeight;
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            const BlockType::ID *ids = chunk.getBlockIDs(ChunkIndex{x, y, zmin}.getOffset());
+            for (int z = 0; z < SectionHeight; z++) {
+                count += ids[z] < entries.size() && entries[ids[z]].model == Model::CUSTOM;
+            }
+        }
+    }
+    return count;
+}
+
+// The row made of bit number bit of each block's flags
+static ChunkFaceMasks::Row gatherRow(const uint8_t *flags, int bit) {
+    ChunkFaceMasks::Row row = 0;
+    for (int z = 0; z < Chunk::ZSize; z += 8) {
+        uint64_t word;
+        std::memcpy(&word, flags + z, sizeof(word));
+        // Moves bit 0 of byte i to bit 56+i, for little endian bytes
+        word = (word >> bit) & 0x0101010101010101ull;
+        row |= static_cast<ChunkFaceMasks::Row>((word * 0x0102040810204080ull) >> 56) << z;
+    }
+    return row;
+}
+
+template <typename F>
+void BlockVisualRegistry::forEachBlock(const ChunkFaceMasks::Mask &mask,
+                                       const Chunk &chunk,
+                                       ChunkFaceMasks::Row range,
+                                       F f) {
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            auto row = mask[ChunkFaceMasks::rowIndex(x, y)] & range;
+            while (row) {
+                int z = __builtin_ctz(row);
+                row &= row - 1;
+
+                ChunkIndex pos{x, y, z};
+                f(pos, chunk.getBlockID(pos.getOffset()));
+            }
+        }
+    }
+}
+
+void BlockVisualRegistry::tesselateRange(MeshBuilder &builder,
+                                         const ChunkNeighborhood &neighborhood,
+                                         int zmin, int zmax,
+                                         std::vector<PlantInstance> *plants) const {
+    const bool faces = geometry == ChunkGeometry::FACES;
+    builder.reset(faces ? chunkFaceFormat() : chunkMeshFormat());
+    if (plants) {
+        plants->clear();
+    }
+    const Chunk &chunk = *neighborhood.chunk;
+    std::vector<uint8_t> scratch_flags;
+    const std::vector<uint8_t> &flags = findFlags(chunk.getBlockTypes(), scratch_flags);
+
+    // Read one block beyond the range to cull its top and bottom faces.
+    // Bits outside of that are left clear, and ignored below.
+    const int zread_min = std::max(zmin - 1, 0);
+    const int zread_max = std::min(zmax + 1, Chunk::ZSize);
+
+    // Sort every block into masks by what it is, without branching on it,
+    // then deal with each kind of model in a batch. A row's flags are
+    // looked up a byte per block, and each mask's row gathered out of
+    // them eight blocks at a time.
+    static_assert(Chunk::ZSize % 8 == 0, "rows are gathered a word at a time");
+    ChunkFaceMasks::Mask cubes, culling, opaque, plant_mask, custom_mask;
+    uint8_t rowflags[Chunk::ZSize] = {};
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            const BlockType::ID *ids = chunk.getBlockIDs(ChunkIndex{x, y, 0}.getOffset());
+            for (int z = zread_min; z < zread_max; z++) {
+                rowflags[z] = ids[z] < flags.size() ? flags[ids[z]] : 0;
+            }
+
+            auto r = ChunkFaceMasks::rowIndex(x, y);
+            cubes[r] = gatherRow(rowflags, CUBE_BIT);
+            culling[r] = gatherRow(rowflags, CULLING_BIT);
+            opaque[r] = gatherRow(rowflags, OPAQUE_BIT);
+            plant_mask[r] = gatherRow(rowflags, PLANT_BIT);
+            custom_mask[r] = gatherRow(rowflags, CUSTOM_BIT);
+        }
+    }
+
+    ChunkFaceMasks::Row range = 0;
+    for (int z = zmin; z < zmax; z++) {
+        range |= ChunkFaceMasks::bit(z);
+    }
+
+    forEachBlock(plant_mask, chunk, range, [&](const ChunkIndex &pos, BlockType::ID id) {
+        if (plants) {
+            plants->push_back(makePlantInstance(pos, entries[id].plant_layer));
+        } else if (!faces) {
+            PlantBlockVisual::tesselateAt(builder, pos.getVec(), entries[id].plant_layer);
+        }
+    });
+    if (!faces) {
+        forEachBlock(custom_mask, chunk, range, [&](const ChunkIndex &pos, BlockType::ID id) {
+            entries[id].visual->tesselate(builder, *this, neighborhood, pos, chunk.getBlock(pos));
+        });
+    }
+
+    FaceMap<ChunkFaceMasks::Border> borders;
+    for (Face face : all_faces) {
+        if (const auto &neighbor = neighborhood.neighbors[face]) {
+            borders[face] = getBorder(*neighbor, face, zmin, zmax, flags);
+        } else {
+            borders[face].fill(0);
+        }
+    }
+
+    ChunkFaceMasks masks;
+    masks.compute(cubes, culling, opaque, borders);
+
+    Occluders occluders;
+    getOccluders(occluders, neighborhood, opaque, zmin, zmax, flags);
+    auto occludes = [&](const glm::ivec3 &pos) -> bool {
+        const uint64_t column = occluders[(pos.x + 1) + OccluderSize*(pos.y + 1)];
+        return (column >> (pos.z + 1)) & 1;
+    };
+
+    // Scatter the visible faces into slices for the greedy mesher, with
+    // their ambient occlusion. Slices are left zeroed by meshSlice, so
+    // they can be reused for every face.
+    std::vector<GreedyMesher::Slice> slices(GreedyMesher::Size);
+    for (Face face : all_faces) {
+        builder.startRange();
+        const auto &mask = masks.getFaceMask(face);
+        uint32_t used_depths = 0;
+
+        for (int x = 0; x < Chunk::XSize; x++) {
+            for (int y = 0; y < Chunk::YSize; y++) {
+                auto row = mask[ChunkFaceMasks::rowIndex(x, y)] & range;
+                while (row) {
+                    int z = __builtin_ctz(row);
+                    row &= row - 1;
+
+                    ChunkIndex pos{x, y, z};
+                    const VisualEntry &entry = entries[chunk.getBlockID(pos.getOffset())];
+                    auto coords = GreedyMesher::sliceCoords(face, pos.getVec());
+                    auto &slice = slices[coords.x];
+                    const uint8_t occlusion =
+                        GreedyMesher::getOcclusion(face, pos.getVec(), occludes);
+                    slice[GreedyMesher::sliceOffset(coords.y, coords.z)] =
+                        GreedyMesher::faceValue(entry.face_layers[face], occlusion);
+                    used_depths |= 1u << coords.x;
+                }
+            }
+        }
+
+        while (used_depths) {
+            int depth = __builtin_ctz(used_depths);
+            used_depths &= used_depths - 1;
+            GreedyMesher::meshSlice(builder, face, depth, slices[depth], geometry);
+        }
+    }
+}
+
+uint32_t BlockVisualRegistry::getVisibleRanges(const glm::vec3 &eye,
+                                               const glm::vec3 &min,
+                                               const glm::vec3 &max) {
+    uint32_t ranges = 1;
+    for (Face face : all_faces) {
+        // A face is only visible from in front of it, and the faces
+        // pointing along +axis are all in front of min, those pointing
+        // along -axis behind max
+        const glm::ivec3 &normal = faceNormal(face);
+        const int axis = normal.x != 0 ? 0 : normal.y != 0 ? 1 : 2;
+        const bool visible = normal[axis] > 0 ? eye[axis] > min[axis] : eye[axis] < max[axis];
+        if (visible) {
+            ranges |= 1u << getFaceRange(face);
+        }
+    }
+    return ranges;
+}
+
+std::shared_ptr<const Chunk> BlockVisualRegistry::downsample(const Chunk &chunk,
+                                                             int factor) const {
+    const BlockTypeRegistry &blocktypes = chunk.getBlockTypes();
+    std::shared_ptr<Chunk> result{new Chunk{blocktypes}};
+
+    auto isCube = [&](BlockType::ID id) {
+        return id < visuals.size() && visuals[id] && visuals[id]->getCubeFaceTexes();
+    };
+    auto isVisible = [&](BlockType::ID id) {
+        return id < visuals.size() && visuals[id];
+    };
+
+    std::vector<unsigned int> votes;
+    std::vector<BlockType::ID> voters;
+    const unsigned int cellsize = factor*factor*factor;
+
+    for (int cx = 0; cx < Chunk::XSize; cx += factor) {
+        for (int cy = 0; cy < Chunk::YSize; cy += factor) {
+            for (int cz = 0; cz < Chunk::ZSize; cz += factor) {
+                unsigned int cube_votes = 0;
+                for (int x = cx; x < cx + factor; x++) {
+                    for (int y = cy; y < cy + factor; y++) {
+                        const auto *ids = chunk.getBlockIDs(ChunkIndex{x, y, cz}.getOffset());
+                        for (int z = 0; z < factor; z++) {
+                            const auto id = ids[z];
+                            if (id >= votes.size()) {
+                                votes.resize(id+1);
+                            }
+                            if (votes[id]++ == 0) {
+                                voters.push_back(id);
+                            }
+                        }
+                    }
+                }
+
+                BlockType::ID winner = voters.front();
+                if (voters.size() > 1) {
+                    for (auto id : voters) {
+                        if (isCube(id)) {
+                            cube_votes += votes[id];
+                        }
+                    }
+
+                    // Sorted so that ties go to the lowest ID, not the first seen
+                    const bool cube = 2*cube_votes >= cellsize;
+                    std::sort(std::begin(voters), std::end(voters));
+                    int best = -1;
+                    for (auto id : voters) {
+                        int rank;
+                        if (cube) {
+                            rank = isCube(id) ? votes[id] : -1;
+                        } else if (isCube(id)) {
+                            rank = -1;
+                        } else {
+                            // Prefer leaving the cell empty over keeping a plant
+                            rank = votes[id] + (isVisible(id) ? 0 : cellsize);
+                        }
+
+                        if (rank > best) {
+                            best = rank;
+                            winner = id;
+                        }
+                    }
+                }
+
+                for (auto id : voters) {
+                    votes[id] = 0;
+                }
+                voters.clear();
+
+                const Block block = blocktypes.getType(winner);
+                for (int x = cx; x < cx + factor; x++) {
+                    for (int y = cy; y < cy + factor; y++) {
+                        for (int z = cz; z < cz + factor; z++) {
+                            result->setBlock(ChunkIndex{x, y, z}, block);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
 }
 
-void BlockVisualRegistry::tesselate(MeshBuilder &builder, const Chunk &chunk) const {
-    builder.reset(MeshFormat{3, 3, 3});
+namespace {
+// FNV-1a style, but over whole 64 bit words where possible, since
+// hashing every block a section reads is otherwise as slow as meshing it
+class IDHasher {
+public:
+    void add(uint64_t val) { hash = (hash ^ val) * 1099511628211ull; }
 
-    for (auto &pos : ChunkIndex::range) {
-        auto block = chunk.getBlock(pos);
-        auto visualptr = getVisual(block.getType().id);
-        if (visualptr) {
-            visualptr->tesselate(builder, *this, chunk, pos, block);
+    void add(const BlockType::ID *ids, int count) {
+        constexpr int per_word = sizeof(uint64_t) / sizeof(BlockType::ID);
+        for (; count >= per_word; ids += per_word, count -= per_word) {
+            uint64_t word;
+            std::memcpy(&word, ids, sizeof(word));
+            add(word);
         }
+        for (; count > 0; ids++, count--) {
+            add(*ids);
+        }
+    }
+
+    uint64_t get() const { return hash; }
+
+private:
+    uint64_t hash = 14695981039346656037ull;
+};
+
+// IDHasher's hash alongside a second, mixed differently, for telling
+// sections apart where a single 64 bit collision would show
+class MeshHasher {
+public:
+    void add(uint64_t val) {
+        first.add(val);
+        check ^= val * 0xff51afd7ed558ccdull;
+        check = ((check << 31) | (check >> 33)) * 0xc4ceb9fe1a85ec53ull;
     }
+
+    BlockVisualRegistry::MeshHash get() const { return {first.get(), check}; }
+
+private:
+    IDHasher first;
+    uint64_t check = 0x9e3779b97f4a7c15ull;
+};
+
+// The blocks a section from zmin to zmax reads out of the chunk at offset
+// from its own, in that chunk's coordinates: the section and one block
+// beyond it all round. Empty unless min < max along every axis.
+struct ReadBox {
+    glm::ivec3 min;
+    glm::ivec3 max;
+
+    ReadBox(const glm::ivec3 &offset, int zmin, int zmax) {
+        const glm::ivec3 size{Chunk::XSize, Chunk::YSize, Chunk::ZSize};
+        const glm::ivec3 lo{-1, -1, zmin - 1};
+        const glm::ivec3 hi{Chunk::XSize + 1, Chunk::YSize + 1, zmax + 1};
+        for (int i = 0; i < 3; i++) {
+            const int base = offset[i]*size[i];
+            min[i] = std::max(lo[i], base) - base;
+            max[i] = std::min(hi[i], base + size[i]) - base;
+        }
+    }
+
+    bool empty() const {
+        return min.x >= max.x || min.y >= max.y || min.z >= max.z;
+    }
+};
+}
+
+ChunkFaceMasks::Mask BlockVisualRegistry::getOpaqueMask(const Chunk &chunk) const {
+    std::vector<bool> opaque_ids(entries.size());
+    for (BlockType::ID id = 0; id < entries.size(); id++) {
+        opaque_ids[id] = entries[id].model == Model::CUBE && entries[id].opaque;
+    }
+
+    ChunkFaceMasks::Mask mask;
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            const BlockType::ID *ids = chunk.getBlockIDs(ChunkIndex{x, y, 0}.getOffset());
+            ChunkFaceMasks::Row row = 0;
+            for (int z = 0; z < Chunk::ZSize; z++) {
+                if (ids[z] < opaque_ids.size() && opaque_ids[ids[z]]) {
+                    row |= ChunkFaceMasks::bit(z);
+                }
+            }
+            mask[ChunkFaceMasks::rowIndex(x, y)] = row;
+        }
+    }
+    return mask;
+}
+
+template <typename Hasher, typename AddIDs>
+void BlockVisualRegistry::hashSectionIDs(Hasher &hasher,
+                                         const ChunkNeighborhood &neighborhood,
+                                         int section,
+                                         AddIDs add) {
+    const int zmin = section*SectionHeight;
+    const int zmax = zmin + SectionHeight;
+
+    // Every chunk around the section's, edges and corners included, for
+    // ambient occlusion, though most only touch it along a row or a
+    // single block
+    auto addChunk = [&](const Chunk *chunk, const glm::ivec3 &offset) {
+        const ReadBox box{offset, zmin, zmax};
+        if (box.empty()) {
+            return;
+        }
+        if (!chunk) {
+            // Distinct from any block ID, missing neighbours don't cull
+            hasher.add(~uint64_t{0});
+            return;
+        }
+        for (int x = box.min.x; x < box.max.x; x++) {
+            for (int y = box.min.y; y < box.max.y; y++) {
+                ChunkIndex pos{x, y, box.min.z};
+                add(hasher, chunk->getBlockIDs(pos.getOffset()), box.max.z - box.min.z);
+            }
+        }
+    };
+
+    addChunk(neighborhood.chunk.get(), glm::ivec3{0, 0, 0});
+    for (Face face : all_faces) {
+        addChunk(neighborhood.neighbors[face].get(), faceNormal(face));
+    }
+    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+        addChunk(neighborhood.diagonals[i].get(), ChunkNeighborhood::diagonal_offsets[i]);
+    }
+}
+
+uint64_t BlockVisualRegistry::hashSection(const ChunkNeighborhood &neighborhood,
+                                          int section) {
+    IDHasher hasher;
+    hashSectionIDs(hasher, neighborhood, section,
+                   [](IDHasher &hasher, const BlockType::ID *ids, int count) {
+                       hasher.add(ids, count);
+                   });
+    return hasher.get();
+}
+
+BlockVisualRegistry::MeshHash BlockVisualRegistry::hashSectionMesh(
+    const ChunkNeighborhood &neighborhood,
+    int section) const
+{
+    // Blocks that leave nothing in the mesh all hash the same, and
+    // unlike missing neighbours
+    const uint64_t nothing = ~uint64_t{1};
+    std::vector<uint64_t> mesh_ids(entries.size(), nothing);
+    for (BlockType::ID id = 0; id < entries.size(); id++) {
+        const Model model = entries[id].model;
+        if (model != Model::NONE && model != Model::PLANT) {
+            mesh_ids[id] = id;
+        }
+    }
+
+    MeshHasher hasher;
+    hashSectionIDs(hasher, neighborhood, section,
+                   [&](MeshHasher &hasher, const BlockType::ID *ids, int count) {
+                       for (int i = 0; i < count; i++) {
+                           hasher.add(ids[i] < mesh_ids.size() ? mesh_ids[ids[i]] : nothing);
+                       }
+                   });
+    return hasher.get();
+}
+
+void BlockVisualRegistry::getOccluders(Occluders &occluders,
+                                       const ChunkNeighborhood &neighborhood,
+                                       const ChunkFaceMasks::Mask &opaque,
+                                       int zmin, int zmax,
+                                       const std::vector<uint8_t> &flags) {
+    occluders.fill(0);
+    auto column = [&](int x, int y) -> uint64_t & {
+        return occluders[(x + 1) + OccluderSize*(y + 1)];
+    };
+    auto isOpaque = [&](const Chunk &chunk, const ChunkIndex &pos) {
+        const auto id = chunk.getBlockID(pos.getOffset());
+        return id < flags.size() && (flags[id] & (1 << OPAQUE_BIT));
+    };
+
+    // The chunk's own, which opaque already has one block beyond the
+    // range of
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            column(x, y) = uint64_t{opaque[ChunkFaceMasks::rowIndex(x, y)]} << 1;
+        }
+    }
+
+    // The rest from the chunks around it, a block out from the section
+    const glm::ivec3 size{Chunk::XSize, Chunk::YSize, Chunk::ZSize};
+    auto addChunk = [&](const Chunk *chunk, const glm::ivec3 &offset) {
+        if (!chunk) {
+            return;
+        }
+        const ReadBox box{offset, zmin, zmax};
+        const glm::ivec3 base = offset*size;
+        for (int x = box.min.x; x < box.max.x; x++) {
+            for (int y = box.min.y; y < box.max.y; y++) {
+                uint64_t &bits = column(base.x + x, base.y + y);
+                for (int z = box.min.z; z < box.max.z; z++) {
+                    if (isOpaque(*chunk, ChunkIndex{x, y, z})) {
+                        bits |= uint64_t{1} << (base.z + z + 1);
+                    }
+                }
+            }
+        }
+    };
+
+    for (Face face : all_faces) {
+        addChunk(neighborhood.neighbors[face].get(), faceNormal(face));
+    }
+    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+        addChunk(neighborhood.diagonals[i].get(), ChunkNeighborhood::diagonal_offsets[i]);
+    }
+}
+
+ChunkFaceMasks::Border BlockVisualRegistry::getBorder(const Chunk &neighbor,
+                                                      Face face,
+                                                      int zmin, int zmax,
+                                                      const std::vector<uint8_t> &flags) {
+    ChunkFaceMasks::Border border;
+    border.fill(0);
+
+    // Only the layers touching zmin to zmax matter
+    int jmin = zmin, jmax = zmax;
+    if (face == Face::TOP || face == Face::BOTTOM) {
+        const bool touches = face == Face::TOP ? zmax == Chunk::ZSize : zmin == 0;
+        if (!touches) {
+            return border;
+        }
+        jmin = 0;
+        jmax = Chunk::YSize;
+    }
+
+    for (int i = 0; i < Chunk::XSize; i++) {
+        ChunkFaceMasks::Row row = 0;
+        for (int j = jmin; j < jmax; j++) {
+            auto id = neighbor.getBlockID(getBorderIndex(face, i, j).getOffset());
+            if (id < flags.size() && (flags[id] & (1 << OPAQUE_BIT))) {
+                row |= ChunkFaceMasks::bit(j);
+            }
+        }
+        border[i] = row;
+    }
+    return border;
+}
+
+ChunkIndex BlockVisualRegistry::getBorderIndex(Face face, int i, int j) {
+    // The neighbour's layer facing us is on the opposite side of face,
+    // laid out as described by ChunkFaceMasks::Border
+    switch (face) {
+    case Face::RIGHT:  return {0, i, j};
+    case Face::LEFT:   return {Chunk::XSize-1, i, j};
+    case Face::BACK:   return {i, 0, j};
+    case Face::FRONT:  return {i, Chunk::YSize-1, j};
+    case Face::TOP:    return {i, j, 0};
+    case Face::BOTTOM: return {i, j, Chunk::ZSize-1};
+    }
+    return {};
+}
+
+bool BlockVisualRegistry::isOccluder(const ChunkNeighborhood &neighborhood,
+                                     const glm::ivec3 &pos) const {
+    const glm::ivec3 size{Chunk::XSize, Chunk::YSize, Chunk::ZSize};
+    glm::ivec3 offset;
+    for (int i = 0; i < 3; i++) {
+        offset[i] = pos[i] < 0 ? -1 : pos[i] >= size[i] ? 1 : 0;
+    }
+    const Chunk *chunk = neighborhood.getAdjacent(offset).get();
+    if (!chunk) {
+        return false;
+    }
+
+    const auto id = chunk->getBlockID(ChunkIndex{pos - offset*size}.getOffset());
+    return id < entries.size() && entries[id].opaque;
+}
+
+bool BlockVisualRegistry::isFaceHidden(const Chunk &chunk,
+                                       const ChunkIndex &pos,
+                                       const Block &block,
+                                       Face face) const {
+    if (!block.getType().solid) {
+        return false;
+    }
+
+    auto adjpos = pos.adjacent(face);
+    if (!adjpos) {
+        return false;
+    }
+
+    auto visualptr = getVisual(chunk.getBlock(adjpos).getType().id);
+    return visualptr && !visualptr->isTransparent();
 }
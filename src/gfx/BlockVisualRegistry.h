@@ -2,10 +2,15 @@
 #define BLOCKVISUALREGISTRY_H
 
 #include "BlockType.h"
+#include "ChunkNeighborhood.h"
 #include "gfx/BlockVisual.h"
 #include "gfx/Texture.h"
+#include "gfx/ChunkFaceMasks.h"
+#include "gfx/ChunkVertex.h"
 #include <vector>
+#include <array>
 #include <memory>
+#include <cstdint>
 
 class BlockVisualRegistry {
 public:
@@ -15,8 +20,96 @@ public:
     const BlockVisual *getVisual(BlockType::ID id) const;
     bool hasVisual(BlockType::ID id) const;
     
-    void prepareTesselate();
-    void tesselate(MeshBuilder &builder, const Chunk &chunk) const;
+    // Builds the block textures, and caches the flags meshing needs for
+    // chunks of types. Chunks of other registries still mesh, but work
+    // the flags out again each time.
+    void prepareTesselate(const BlockTypeRegistry &types);
+    // Just caches the flags, for meshing without a GL context
+    void prepareFlags(const BlockTypeRegistry &types);
+    // Chunks are meshed in slabs of SectionHeight blocks along z, so that
+    // an edit only rebuilds the slabs it affects
+    static constexpr int SectionHeight = 8;
+    static constexpr int SectionCount = Chunk::ZSize / SectionHeight;
+
+    // Faces against the neighbouring chunks are culled too, so the mesh
+    // must be rebuilt whenever one of the neighbours changes. Given
+    // plants, plants are left out of the mesh and listed there instead,
+    // to be drawn as instances.
+    // How tesselate writes the cube faces, see ChunkGeometry. Face
+    // records only hold cube faces, so with FACES plants are only
+    // meshed as instances, and custom visuals are left out (see
+    // countLeftOut).
+    void setGeometry(ChunkGeometry geometry) { this->geometry = geometry; }
+    ChunkGeometry getGeometry() const { return geometry; }
+
+    void tesselate(MeshBuilder &builder,
+                   const ChunkNeighborhood &neighborhood,
+                   std::vector<PlantInstance> *plants = nullptr) const;
+    void tesselateSection(MeshBuilder &builder,
+                          const ChunkNeighborhood &neighborhood,
+                          int section,
+                          std::vector<PlantInstance> *plants = nullptr) const;
+    // Just the plants of a section, as tesselateSection lists them
+    void findPlants(std::vector<PlantInstance> &plants,
+                    const Chunk &chunk,
+                    int section) const;
+    // The blocks of a section tesselateSection leaves out of the mesh,
+    // which with FACES are those with custom visuals, and otherwise none
+    int countLeftOut(const Chunk &chunk, int section) const;
+
+    // Meshes are split into RangeCount index ranges (see
+    // MeshBuilder::startRange). The first holds the blocks that tesselate
+    // themselves, the rest the cube faces pointing each way.
+    static constexpr int RangeCount = 7;
+    static int getFaceRange(Face face) { return 1 + static_cast<int>(face); }
+    // The blocks that tesselate themselves (plants) have see-through
+    // texels, so they're drawn in a separate pass from the cube faces
+    static constexpr uint32_t CutoutRanges = 1;
+
+    // Bitmask of the ranges that can have faces visible from eye, for a
+    // mesh lying within the box [min, max]
+    static uint32_t getVisibleRanges(const glm::vec3 &eye,
+                                     const glm::vec3 &min,
+                                     const glm::vec3 &max);
+
+    // A copy of chunk at 1/factor the resolution, for meshing distant
+    // chunks. Each factor^3 cell becomes its most common cube block when
+    // at least half of it is cubes, and its most common invisible block
+    // (air) otherwise, so plants and other small visuals drop out. The
+    // copy keeps the full size, so it meshes like any other chunk.
+    std::shared_ptr<const Chunk> downsample(const Chunk &chunk, int factor) const;
+
+    // The opaque cube blocks of chunk, which block lines of sight, see
+    // ChunkVisibility
+    ChunkFaceMasks::Mask getOpaqueMask(const Chunk &chunk) const;
+
+    // Hashes every block tesselateSection reads, including the layers
+    // around the section, so unchanged sections can skip rebuilding
+    static uint64_t hashSection(const ChunkNeighborhood &neighborhood, int section);
+    // Likewise, but with plants taken for air, so that it only changes
+    // when the section's mesh does if plants are instanced. Sections with
+    // the same mesh hash share a mesh, so it's two independent 64 bit
+    // hashes, which must both collide for two sections to be mixed up.
+    struct MeshHash {
+        uint64_t hash;
+        uint64_t check;
+
+        bool operator==(const MeshHash &other) const {
+            return hash == other.hash && check == other.check;
+        }
+        bool operator!=(const MeshHash &other) const { return !(*this == other); }
+    };
+    MeshHash hashSectionMesh(const ChunkNeighborhood &neighborhood, int section) const;
+
+    // Whether the block at pos, up to a block outside the chunk, is
+    // opaque and shades the faces around it, as tesselate takes it.
+    // Blocks of missing chunks are taken to be open.
+    bool isOccluder(const ChunkNeighborhood &neighborhood, const glm::ivec3 &pos) const;
+
+    bool isFaceHidden(const Chunk &chunk,
+                      const ChunkIndex &pos,
+                      const Block &block,
+                      Face face) const;
 
     // TODO, put textures into meshes
     const ArrayTexture &getBlockTex() const { return block_tex; }
@@ -25,6 +118,70 @@ private:
     TextureArrayBuilder block_tex_builder;
     ArrayTexture block_tex;
     std::vector<std::unique_ptr<const BlockVisual>> visuals;
+    ChunkGeometry geometry = ChunkGeometry::VERTICES;
+
+    // Everything meshing needs to know about a block ID, flattened out of
+    // its visual by makeVisual, so that meshing doesn't call into visuals
+    // block by block. Only CUSTOM models still tesselate themselves.
+    enum class Model : uint8_t { NONE, CUBE, PLANT, CUSTOM };
+    struct VisualEntry {
+        Model model = Model::NONE;
+        bool opaque = false;
+        FaceMap<unsigned int> face_layers{}; // CUBE
+        unsigned int plant_layer = 0; // PLANT
+        const BlockVisual *visual = nullptr;
+    };
+    std::vector<VisualEntry> entries;
+
+    // Per ID flags for sorting a chunk's blocks into masks, by bit
+    // number. They need the chunk's block types, for whether cubes cull.
+    enum FlagBit { CUBE_BIT, CULLING_BIT, OPAQUE_BIT, PLANT_BIT, CUSTOM_BIT };
+    std::vector<uint8_t> getFlags(const BlockTypeRegistry &types) const;
+    // The cached flags if they're for types, as LightPropagator keeps its
+    // own, otherwise new ones put in scratch
+    const std::vector<uint8_t> &findFlags(const BlockTypeRegistry &types,
+                                          std::vector<uint8_t> &scratch) const;
+    std::vector<uint8_t> cached_flags;
+    const BlockTypeRegistry *flag_types = nullptr;
+    unsigned int flag_type_count = 0;
+
+    void tesselateRange(MeshBuilder &builder,
+                        const ChunkNeighborhood &neighborhood,
+                        int zmin, int zmax,
+                        std::vector<PlantInstance> *plants) const;
+
+    // Calls f(pos, id) for each block of chunk in mask, within the rows
+    // of range
+    template <typename F>
+    static void forEachBlock(const ChunkFaceMasks::Mask &mask,
+                             const Chunk &chunk,
+                             ChunkFaceMasks::Row range,
+                             F f);
+
+    template <typename Hasher, typename AddIDs>
+    static void hashSectionIDs(Hasher &hasher,
+                               const ChunkNeighborhood &neighborhood,
+                               int section,
+                               AddIDs add);
+
+    // The opaque blocks that can occlude the faces of the blocks from
+    // zmin to zmax, one layer out from them all round, for ambient
+    // occlusion. They're held as columns along z, with block (x, y, z)
+    // at bit z + 1 of column (x + 1) + OccluderSize*(y + 1). Blocks of
+    // missing chunks are left clear.
+    static constexpr int OccluderSize = Chunk::XSize + 2;
+    using Occluders = std::array<uint64_t, OccluderSize*OccluderSize>;
+    static void getOccluders(Occluders &occluders,
+                             const ChunkNeighborhood &neighborhood,
+                             const ChunkFaceMasks::Mask &opaque,
+                             int zmin, int zmax,
+                             const std::vector<uint8_t> &flags);
+
+    static ChunkFaceMasks::Border getBorder(const Chunk &neighbor,
+                                            Face face,
+                                            int zmin, int zmax,
+                                            const std::vector<uint8_t> &flags);
+    static ChunkIndex getBorderIndex(Face face, int i, int j);
 };
 
 #endif
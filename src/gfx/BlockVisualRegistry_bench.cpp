@@ -0,0 +1,461 @@
+#include "BlockVisualRegistry.h"
+#include "ChunkFaceMasks.h"
+#include "ChunkVisibility.h"
+#include "SimpleBlockVisual.h"
+#include "PlantBlockVisual.h"
+#include "MeshDataPool.h"
+#include "BlockTypeRegistry.h"
+#include "TestWorldGenerator.h"
+#include "util/Benchmark.h"
+#include <memory>
+#include <vector>
+
+// The block types from game.lua, so that benchmarks see the same IDs and
+// visuals as the game. Run from the res directory for the textures.
+namespace {
+struct BlockFixture {
+    BlockTypeRegistry types;
+    BlockVisualRegistry visuals{16};
+
+    BlockFixture() {
+        TestWorldGenerator::makeBlockTypes(types);
+        visuals.makeVisual(types.getType("stone").id, SimpleBlockVisualInfo{"stone.png"});
+        visuals.makeVisual(types.getType("dirt").id, SimpleBlockVisualInfo{"dirt.png"});
+
+        SimpleBlockVisualInfo grass_vis;
+        grass_vis.face_tex_filenames.fill("grass_side.png");
+        grass_vis.face_tex_filenames[Face::TOP] = "grass.png";
+        grass_vis.face_tex_filenames[Face::BOTTOM] = "dirt.png";
+        visuals.makeVisual(types.getType("grass").id, grass_vis);
+
+        PlantBlockVisualInfo tall_grass_vis;
+        tall_grass_vis.tex_filename = "tall_grass.png";
+        visuals.makeVisual(types.getType("tall_grass").id, tall_grass_vis);
+        visuals.prepareFlags(types);
+    }
+
+    std::shared_ptr<const Chunk> makeStoneChunk() const {
+        std::shared_ptr<Chunk> chunk{new Chunk{types}};
+        chunk->fill(types.getType("stone"));
+        return chunk;
+    }
+
+    // Chunks at height z of a few worlds, along with the chunks around them.
+    // The ground is in the z=0 chunks, dipping into z=-1 in places.
+    std::vector<ChunkNeighborhood> makeChunks(int z) const {
+        std::vector<ChunkNeighborhood> chunks;
+        TestWorldGenerator gen;
+        for (int seed : {1, 2, 3}) {
+            gen.reseed(seed);
+            for (int x = -1; x <= 0; x++) {
+                for (int y = -1; y <= 0; y++) {
+                    glm::ivec3 pos{x, y, z};
+                    ChunkNeighborhood neighborhood;
+                    neighborhood.chunk = gen.generateChunk(pos, types);
+                    for (Face face : all_faces) {
+                        neighborhood.neighbors[face] =
+                            gen.generateChunk(adjacentPos(pos, face), types);
+                    }
+                    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+                        neighborhood.diagonals[i] = gen.generateChunk(
+                            pos + ChunkNeighborhood::diagonal_offsets[i], types);
+                    }
+                    chunks.push_back(std::move(neighborhood));
+                }
+            }
+        }
+        return chunks;
+    }
+
+    // Chunks straddling the ground level, where most faces end up
+    std::vector<ChunkNeighborhood> makeSurfaceChunks() const {
+        return makeChunks(0);
+    }
+
+    // Whether the block at offset has a visual, and one that only accepts
+    bool isVisual(const Chunk &chunk, unsigned int offset,
+                  bool (*only)(const BlockVisual &)) const {
+        const BlockVisual *visual = visuals.getVisual(chunk.getBlockID(offset));
+        return visual && only(*visual);
+    }
+
+    // Copies of chunks, neighbours and all, with air in place of every
+    // block whose visual only turns down
+    std::vector<ChunkNeighborhood> filterChunks(const std::vector<ChunkNeighborhood> &chunks,
+                                                bool (*only)(const BlockVisual &)) const {
+        auto filter = [&](const Chunk &chunk) {
+            std::shared_ptr<Chunk> filtered{new Chunk{chunk}};
+            for (unsigned int offset = 0; offset < Chunk::XSize*Chunk::YSize*Chunk::ZSize; offset++) {
+                if (!isVisual(chunk, offset, only)) {
+                    filtered->setBlock(offset, types.getType("air"));
+                }
+            }
+            return filtered;
+        };
+
+        std::vector<ChunkNeighborhood> filtered;
+        for (const auto &neighborhood : chunks) {
+            ChunkNeighborhood copy;
+            copy.chunk = filter(*neighborhood.chunk);
+            for (Face face : all_faces) {
+                copy.neighbors[face] = filter(*neighborhood.neighbors[face]);
+            }
+            for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+                copy.diagonals[i] = filter(*neighborhood.diagonals[i]);
+            }
+            filtered.push_back(std::move(copy));
+        }
+        return filtered;
+    }
+};
+}
+
+static bool isSimpleVisual(const BlockVisual &visual) {
+    return visual.getCubeFaceTexes() != nullptr;
+}
+
+static bool isPlantVisual(const BlockVisual &visual) {
+    return visual.getPlantTex() != nullptr;
+}
+
+// Meshes chunks into a MeshBuilder, without ever building the mesh, so
+// that no GL context is needed. Given only, the chunks are cut down to
+// blocks with the visuals only accepts, and those are the blocks counted
+// as items. Otherwise every block is.
+static void benchTesselate(BenchmarkState &state,
+                           const BlockFixture &fixture,
+                           std::vector<ChunkNeighborhood> chunks,
+                           bool instance_plants = false,
+                           bool (*only)(const BlockVisual &) = nullptr) {
+    double chunk_blocks = 0;
+    if (only) {
+        chunks = fixture.filterChunks(chunks, only);
+        for (const auto &neighborhood : chunks) {
+            for (unsigned int offset = 0; offset < Chunk::XSize*Chunk::YSize*Chunk::ZSize; offset++) {
+                chunk_blocks += fixture.isVisual(*neighborhood.chunk, offset, only);
+            }
+        }
+    } else {
+        chunk_blocks = chunks.size() * Chunk::XSize*Chunk::YSize*Chunk::ZSize;
+    }
+
+    MeshBuilder builder;
+    std::vector<PlantInstance> plants;
+    double verts = 0, bytes = 0;
+    unsigned long allocations = 0;
+    while (state.keepRunning()) {
+        // Everything after the first pass is steady state
+        if (state.getIterations() == 2) {
+            allocations = Benchmark::getAllocationCount();
+        }
+        for (const auto &neighborhood : chunks) {
+            fixture.visuals.tesselate(builder, neighborhood,
+                                      instance_plants ? &plants : nullptr);
+            verts += builder.getBuffer().size() / builder.getFormat().getVertexSize();
+            bytes += builder.getBuffer().size() +
+                builder.getIndexBuffer().size() * sizeof(MeshBuilder::Index) +
+                plants.size() * sizeof(PlantInstance);
+        }
+        state.addItems(chunk_blocks);
+    }
+
+    double meshed = state.getIterations() * chunks.size();
+    double steady = (state.getIterations() - 1) * chunks.size();
+    state.setCounter("verts/chunk", verts / meshed);
+    state.setCounter("KiB/chunk", bytes / 1024 / meshed);
+    state.setCounter("us/chunk", 1e6 * state.getSeconds() / meshed);
+    if (only) {
+        state.setCounter("blocks/chunk", chunk_blocks / chunks.size());
+    }
+    if (allocations) {
+        state.setCounter("allocs/chunk",
+                         (Benchmark::getAllocationCount() - allocations) / steady);
+    }
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateStone) {
+    BlockFixture fixture;
+    ChunkNeighborhood neighborhood;
+    neighborhood.chunk = fixture.makeStoneChunk();
+    benchTesselate(state, fixture, {neighborhood});
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateBuriedStone) {
+    BlockFixture fixture;
+    ChunkNeighborhood neighborhood;
+    neighborhood.chunk = fixture.makeStoneChunk();
+    neighborhood.neighbors.fill(neighborhood.chunk);
+    neighborhood.diagonals.fill(neighborhood.chunk);
+    benchTesselate(state, fixture, {neighborhood});
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateSurface) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeSurfaceChunks());
+}
+
+// The way chunks used to be meshed, for comparison: looking up each
+// block's visual and having it tesselate itself, face by face
+BENCHMARK(BlockVisualRegistry, TesselateSurfacePerBlock) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    MeshBuilder builder;
+    double verts = 0;
+    while (state.keepRunning()) {
+        for (const auto &neighborhood : chunks) {
+            const Chunk &chunk = *neighborhood.chunk;
+            builder.reset(chunkMeshFormat());
+            for (auto &pos : ChunkIndex::range) {
+                const Block block = chunk.getBlock(pos);
+                if (const BlockVisual *visual = fixture.visuals.getVisual(block.getType().id)) {
+                    visual->tesselate(builder, fixture.visuals, neighborhood, pos, block);
+                }
+            }
+            verts += builder.getBuffer().size() / builder.getFormat().getVertexSize();
+            state.addItems(Chunk::XSize*Chunk::YSize*Chunk::ZSize);
+        }
+    }
+
+    double meshed = state.getIterations() * chunks.size();
+    state.setCounter("verts/chunk", verts / meshed);
+    state.setCounter("us/chunk", 1e6 * state.getSeconds() / meshed);
+}
+
+// Each kind of visual on its own, deep underground, just below ground
+// level, and at it
+BENCHMARK(BlockVisualRegistry, TesselateSimpleDeep) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeChunks(-2), false, isSimpleVisual);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateSimpleShallow) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeChunks(-1), false, isSimpleVisual);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateSimpleSurface) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeChunks(0), false, isSimpleVisual);
+}
+
+// The same faces as packed face records, a quarter of the bytes
+BENCHMARK(BlockVisualRegistry, TesselateSimpleSurfaceFaces) {
+    BlockFixture fixture;
+    fixture.visuals.setGeometry(ChunkGeometry::FACES);
+    benchTesselate(state, fixture, fixture.makeChunks(0), false, isSimpleVisual);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselatePlantShallow) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeChunks(-1), false, isPlantVisual);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselatePlantSurface) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeChunks(0), false, isPlantVisual);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselatePlantSurfaceInstanced) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeChunks(0), true, isPlantVisual);
+}
+
+// Meshing sections and handing them over as ChunkMeshManager's workers
+// do, either moving the mesh out of the builder in exchange for pooled
+// buffers, or copying the builder. allocs/section counts the steady state
+// allocations of both sides, the main thread handing the buffers back.
+static void benchHandOff(BenchmarkState &state, bool pooled) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    MeshBuilder builder;
+    MeshDataPool pool{64};
+    std::vector<PlantInstance> plants;
+    unsigned long allocations = 0;
+    while (state.keepRunning()) {
+        if (state.getIterations() == 2) {
+            allocations = Benchmark::getAllocationCount();
+        }
+        for (const auto &neighborhood : chunks) {
+            for (int section = 0; section < BlockVisualRegistry::SectionCount; section++) {
+                fixture.visuals.tesselateSection(builder, neighborhood, section, &plants);
+                if (pooled) {
+                    MeshData data = builder.takeData(pool.take());
+                    pool.recycle(std::move(data));
+                } else {
+                    MeshBuilder copy = builder;
+                    (void)copy;
+                }
+            }
+            state.addItems(Chunk::XSize*Chunk::YSize*Chunk::ZSize);
+        }
+    }
+
+    double sections = (state.getIterations() - 1) * chunks.size() *
+        BlockVisualRegistry::SectionCount;
+    state.setCounter("allocs/section",
+                     (Benchmark::getAllocationCount() - allocations) / sections);
+}
+
+BENCHMARK(BlockVisualRegistry, HandOffSurfaceCopied) {
+    benchHandOff(state, false);
+}
+
+BENCHMARK(BlockVisualRegistry, HandOffSurfacePooled) {
+    benchHandOff(state, true);
+}
+
+// Plants as instances of a shared mesh, as ChunkMeshManager draws them
+BENCHMARK(BlockVisualRegistry, TesselateSurfaceInstancedPlants) {
+    BlockFixture fixture;
+    benchTesselate(state, fixture, fixture.makeSurfaceChunks(), true);
+}
+
+BENCHMARK(ChunkFaceMasks, ComputeSurface) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    std::vector<ChunkFaceMasks::Mask> solids(chunks.size());
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+        const Chunk &chunk = *chunks[i].chunk;
+        for (int x = 0; x < Chunk::XSize; x++) {
+            for (int y = 0; y < Chunk::YSize; y++) {
+                ChunkFaceMasks::Row row = 0;
+                for (int z = 0; z < Chunk::ZSize; z++) {
+                    if (chunk.getBlock(ChunkIndex{x, y, z}).getType().solid) {
+                        row |= ChunkFaceMasks::bit(z);
+                    }
+                }
+                solids[i][ChunkFaceMasks::rowIndex(x, y)] = row;
+            }
+        }
+    }
+
+    ChunkFaceMasks masks;
+    while (state.keepRunning()) {
+        for (auto &solid : solids) {
+            masks.compute(solid, solid, solid);
+            state.addItems(Chunk::XSize*Chunk::YSize*Chunk::ZSize);
+        }
+    }
+}
+
+BENCHMARK(BlockVisualRegistry, HashSurfaceSections) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    volatile uint64_t hash;
+    while (state.keepRunning()) {
+        for (const auto &neighborhood : chunks) {
+            for (int section = 0; section < BlockVisualRegistry::SectionCount; section++) {
+                hash = BlockVisualRegistry::hashSection(neighborhood, section);
+            }
+            state.addItems(Chunk::XSize*Chunk::YSize*Chunk::ZSize);
+        }
+    }
+    (void)hash;
+}
+
+// What ChunkMeshManager does after a single block edit: hash every
+// section, and only tesselate the ones that changed
+BENCHMARK(BlockVisualRegistry, RemeshAfterEdit) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    std::vector<ChunkNeighborhood> edited;
+    std::vector<std::vector<uint64_t>> old_hashes;
+    for (const auto &neighborhood : chunks) {
+        std::vector<uint64_t> hashes;
+        for (int section = 0; section < BlockVisualRegistry::SectionCount; section++) {
+            hashes.push_back(BlockVisualRegistry::hashSection(neighborhood, section));
+        }
+        old_hashes.push_back(std::move(hashes));
+
+        // Dig out, or fill in, a block in the middle of the second section
+        ChunkIndex pos{16, 16, 12};
+        std::shared_ptr<Chunk> chunk{new Chunk{*neighborhood.chunk}};
+        const bool solid = chunk->getBlock(pos).getType().solid;
+        chunk->setBlock(pos, fixture.types.getType(solid ? "air" : "stone"));
+        ChunkNeighborhood edit = neighborhood;
+        edit.chunk = chunk;
+        edited.push_back(std::move(edit));
+    }
+
+    MeshBuilder builder;
+    double rebuilt = 0;
+    while (state.keepRunning()) {
+        for (unsigned int i = 0; i < edited.size(); i++) {
+            for (int section = 0; section < BlockVisualRegistry::SectionCount; section++) {
+                auto hash = BlockVisualRegistry::hashSection(edited[i], section);
+                if (hash != old_hashes[i][section]) {
+                    fixture.visuals.tesselateSection(builder, edited[i], section);
+                    rebuilt++;
+                }
+            }
+        }
+    }
+
+    double remeshed = state.getIterations() * edited.size();
+    state.setCounter("sections/edit", rebuilt / remeshed);
+    state.setCounter("us/edit", 1e6 * state.getSeconds() / remeshed);
+}
+
+// Downsampling the chunk and its neighbours, then meshing, for each
+// level of detail
+static void benchTesselateLOD(BenchmarkState &state, int factor) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    MeshBuilder builder;
+    double verts = 0;
+    while (state.keepRunning()) {
+        for (const auto &neighborhood : chunks) {
+            ChunkNeighborhood downsampled;
+            downsampled.chunk = fixture.visuals.downsample(*neighborhood.chunk, factor);
+            for (Face face : all_faces) {
+                downsampled.neighbors[face] =
+                    fixture.visuals.downsample(*neighborhood.neighbors[face], factor);
+            }
+            for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+                downsampled.diagonals[i] =
+                    fixture.visuals.downsample(*neighborhood.diagonals[i], factor);
+            }
+
+            fixture.visuals.tesselate(builder, downsampled);
+            verts += builder.getBuffer().size() / builder.getFormat().getVertexSize();
+            state.addItems(Chunk::XSize*Chunk::YSize*Chunk::ZSize);
+        }
+    }
+
+    double meshed = state.getIterations() * chunks.size();
+    state.setCounter("verts/chunk", verts / meshed);
+    state.setCounter("us/chunk", 1e6 * state.getSeconds() / meshed);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateSurfaceLOD1) {
+    benchTesselateLOD(state, 2);
+}
+
+BENCHMARK(BlockVisualRegistry, TesselateSurfaceLOD2) {
+    benchTesselateLOD(state, 4);
+}
+
+BENCHMARK(ChunkVisibility, ComputeSurface) {
+    BlockFixture fixture;
+    auto chunks = fixture.makeSurfaceChunks();
+
+    std::vector<ChunkFaceMasks::Mask> opaques;
+    for (const auto &neighborhood : chunks) {
+        opaques.push_back(fixture.visuals.getOpaqueMask(*neighborhood.chunk));
+    }
+
+    volatile bool sees;
+    while (state.keepRunning()) {
+        for (const auto &opaque : opaques) {
+            sees = ChunkVisibility::compute(opaque).canSee(Face::TOP, Face::BOTTOM);
+            state.addItems(Chunk::XSize*Chunk::YSize*Chunk::ZSize);
+        }
+    }
+    (void)sees;
+}
@@ -0,0 +1,165 @@
+#include "BlockVisualRegistry.h"
+#include "SimpleBlockVisual.h"
+#include "ChunkVertex.h"
+#include "TestWorldGenerator.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+static bool isVisible(uint32_t ranges, Face face) {
+    return (ranges & (1u << BlockVisualRegistry::getFaceRange(face))) != 0;
+}
+
+TEST(BlockVisualRegistry, EyeInsideSeesAllRanges) {
+    auto ranges = BlockVisualRegistry::getVisibleRanges(
+        glm::vec3{4, 4, 4}, glm::vec3{0, 0, 0}, glm::vec3{32, 32, 8});
+    EXPECT_EQ((1u << BlockVisualRegistry::RangeCount) - 1, ranges);
+}
+
+TEST(BlockVisualRegistry, EyeAboveSkipsBottomFaces) {
+    auto ranges = BlockVisualRegistry::getVisibleRanges(
+        glm::vec3{16, 16, 20}, glm::vec3{0, 0, 0}, glm::vec3{32, 32, 8});
+    EXPECT_TRUE(ranges & 1u);
+    EXPECT_TRUE(isVisible(ranges, Face::TOP));
+    EXPECT_FALSE(isVisible(ranges, Face::BOTTOM));
+    EXPECT_TRUE(isVisible(ranges, Face::RIGHT));
+    EXPECT_TRUE(isVisible(ranges, Face::LEFT));
+    EXPECT_TRUE(isVisible(ranges, Face::BACK));
+    EXPECT_TRUE(isVisible(ranges, Face::FRONT));
+}
+
+TEST(BlockVisualRegistry, EyeOffCornerSeesThreeFaces) {
+    auto ranges = BlockVisualRegistry::getVisibleRanges(
+        glm::vec3{-10, 40, -1}, glm::vec3{0, 0, 0}, glm::vec3{32, 32, 8});
+    EXPECT_TRUE(isVisible(ranges, Face::LEFT));
+    EXPECT_TRUE(isVisible(ranges, Face::BACK));
+    EXPECT_TRUE(isVisible(ranges, Face::BOTTOM));
+    EXPECT_FALSE(isVisible(ranges, Face::RIGHT));
+    EXPECT_FALSE(isVisible(ranges, Face::FRONT));
+    EXPECT_FALSE(isVisible(ranges, Face::TOP));
+}
+
+namespace {
+// Stone, with a texture layer per face, so that no images are loaded
+struct StoneVisualInfo : public BlockVisualInfo {
+    virtual std::unique_ptr<BlockVisual> buildVisual(TextureArrayBuilder &) const {
+        FaceMap<unsigned int> texes;
+        for (Face face : all_faces) {
+            texes[face] = static_cast<unsigned int>(face);
+        }
+        return std::unique_ptr<BlockVisual>{new SimpleBlockVisual{texes}};
+    }
+};
+
+struct StoneFixture {
+    BlockTypeRegistry types;
+    BlockVisualRegistry visuals{16};
+
+    StoneFixture() {
+        TestWorldGenerator::makeBlockTypes(types);
+        visuals.makeVisual(types.getType("stone").id, StoneVisualInfo{});
+        visuals.prepareFlags(types);
+    }
+
+    std::shared_ptr<Chunk> makeChunk(const char *type) const {
+        std::shared_ptr<Chunk> chunk{new Chunk{types}};
+        chunk->fill(types.getType(type));
+        return chunk;
+    }
+};
+
+// The shade of each vertex of a chunk mesh, by position and normal
+using Shades = std::map<std::tuple<int, int, int, int>, int>;
+Shades getShades(const MeshBuilder &builder) {
+    Shades shades;
+    const auto &buf = builder.getBuffer();
+    for (size_t i = 0; i + 8 <= buf.size(); i += 8) {
+        shades[std::make_tuple(buf[i], buf[i + 1], buf[i + 2], buf[i + 3])] = buf[i + 7];
+    }
+    return shades;
+}
+}
+
+// A lone block in the corner of a chunk, with air across the faces and
+// stone across the edges and corners, so that only the chunks on the
+// diagonals shade it. The merged faces and the block's own tesselate
+// should agree.
+TEST(BlockVisualRegistry, CornerBlockShadedAlikeBothWays) {
+    StoneFixture fixture;
+    ChunkNeighborhood neighborhood;
+    auto chunk = fixture.makeChunk("air");
+    const ChunkIndex pos{Chunk::XSize - 1, Chunk::YSize - 1, Chunk::ZSize - 1};
+    chunk->setBlock(pos, fixture.types.getType("stone"));
+    neighborhood.chunk = chunk;
+    for (Face face : all_faces) {
+        neighborhood.neighbors[face] = fixture.makeChunk("air");
+    }
+    neighborhood.diagonals.fill(fixture.makeChunk("stone"));
+
+    MeshBuilder merged;
+    fixture.visuals.tesselateSection(merged, neighborhood, BlockVisualRegistry::SectionCount - 1);
+    MeshBuilder single{chunkMeshFormat()};
+    const BlockVisual &visual = *fixture.visuals.getVisual(fixture.types.getType("stone").id);
+    visual.tesselate(single, fixture.visuals, neighborhood, pos, chunk->getBlock(pos));
+
+    const Shades merged_shades = getShades(merged);
+    const Shades single_shades = getShades(single);
+    ASSERT_EQ(24u, single_shades.size());
+    EXPECT_EQ(single_shades, merged_shades);
+
+    // The top face's far corner has stone on three sides of it
+    const int x = Chunk::XSize, y = Chunk::YSize, z = Chunk::ZSize;
+    const int top = static_cast<int>(ChunkNormal::TOP);
+    EXPECT_EQ(chunkShade(ChunkNormal::TOP, 3), single_shades.at(std::make_tuple(x, y, z, top)));
+}
+
+TEST(BlockVisualRegistry, HashSeesDiagonals) {
+    StoneFixture fixture;
+    ChunkNeighborhood neighborhood;
+    neighborhood.chunk = fixture.makeChunk("air");
+    const int top = BlockVisualRegistry::SectionCount - 1;
+    const uint64_t missing = BlockVisualRegistry::hashSection(neighborhood, top);
+
+    // The edge above the right face only touches the top section
+    const auto &offsets = ChunkNeighborhood::diagonal_offsets;
+    const int edge = std::find(offsets.begin(), offsets.end(), glm::ivec3{1, 0, 1}) - offsets.begin();
+    ASSERT_LT(edge, ChunkNeighborhood::DiagonalCount);
+    const uint64_t bottom = BlockVisualRegistry::hashSection(neighborhood, 0);
+    neighborhood.diagonals[edge] = fixture.makeChunk("air");
+    const uint64_t air = BlockVisualRegistry::hashSection(neighborhood, top);
+    EXPECT_NE(missing, air);
+    EXPECT_EQ(bottom, BlockVisualRegistry::hashSection(neighborhood, 0));
+
+    neighborhood.diagonals[edge] = fixture.makeChunk("stone");
+    EXPECT_NE(air, BlockVisualRegistry::hashSection(neighborhood, top));
+}
+
+namespace {
+// Tesselates itself, like no cube or plant
+class CustomVisual : public BlockVisual {
+public:
+    CustomVisual(const BlockVisualInfo &, TextureArrayBuilder &) { }
+    virtual void tesselate(MeshBuilder &, const BlockVisualRegistry &,
+                           const ChunkNeighborhood &, const ChunkIndex &,
+                           const Block &) const { }
+    virtual bool isTransparent() const { return true; }
+};
+
+struct CustomVisualInfo : public BaseBlockVisualInfo<CustomVisualInfo, CustomVisual> { };
+}
+
+TEST(BlockVisualRegistry, FaceRecordsCountCustomVisualsLeftOut) {
+    StoneFixture fixture;
+    fixture.visuals.makeVisual(fixture.types.getType("dirt").id, CustomVisualInfo{});
+    fixture.visuals.prepareFlags(fixture.types);
+
+    auto chunk = fixture.makeChunk("stone");
+    chunk->setBlock(ChunkIndex{3, 4, 9}, fixture.types.getType("dirt"));
+    chunk->setBlock(ChunkIndex{5, 6, 10}, fixture.types.getType("dirt"));
+    EXPECT_EQ(0, fixture.visuals.countLeftOut(*chunk, 1));
+
+    fixture.visuals.setGeometry(ChunkGeometry::FACES);
+    EXPECT_EQ(2, fixture.visuals.countLeftOut(*chunk, 1));
+    EXPECT_EQ(0, fixture.visuals.countLeftOut(*chunk, 0));
+}
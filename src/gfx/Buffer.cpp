@@ -10,11 +10,50 @@ void Buffer::setData(const void *data, size_t len, Type type) {
         id = tmp;
     }
 
-    GLenum target = (type == ARRAY) ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER;
+    GLenum target = getTarget(type);
 
     glBindBuffer(target, id);
     glBufferData(target, len, data, GL_STATIC_DRAW);
     glBindBuffer(target, 0);
+    size = len;
+}
+
+void Buffer::setSubData(size_t offset, const void *data, size_t len, Type type) {
+    GLenum target = getTarget(type);
+
+    glBindBuffer(target, id);
+    glBufferSubData(target, offset, len, data);
+    glBindBuffer(target, 0);
+}
+
+void *Buffer::mapPersistent(size_t len, Type type) {
+    if (!id) {
+        GLuint tmp;
+        glGenBuffers(1, &tmp);
+        id = tmp;
+    }
+
+    GLenum target = getTarget(type);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glBindBuffer(target, id);
+    glBufferStorage(target, len, nullptr, flags);
+    void *mapping = glMapBufferRange(target, 0, len, flags);
+    glBindBuffer(target, 0);
+    size = len;
+    return mapping;
+}
+
+unsigned int Buffer::getTarget(Type type) {
+    switch (type) {
+    case ELEMENTS:
+        return GL_ELEMENT_ARRAY_BUFFER;
+    case DRAW_INDIRECT:
+        return GL_DRAW_INDIRECT_BUFFER;
+    case ARRAY:
+    default:
+        return GL_ARRAY_BUFFER;
+    }
 }
 
 void Buffer::deleteId() {
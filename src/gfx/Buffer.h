@@ -12,7 +12,8 @@ class Buffer : public IDBase<Buffer> {
 public:
     enum Type {
         ARRAY,
-        ELEMENTS
+        ELEMENTS,
+        DRAW_INDIRECT
     };
 
     Buffer() { }
@@ -22,9 +23,21 @@ public:
     explicit Buffer(const std::vector<T> &vec, Type type=ARRAY) :
         Buffer(&vec.front(), vec.size()*sizeof(T), type) { }
 
+    // data may be null, to allocate len bytes for setSubData
     void setData(const void *data, size_t len, Type type=ARRAY);
+    void setSubData(size_t offset, const void *data, size_t len, Type type=ARRAY);
+    // Allocates len bytes of storage that stays mapped for writing for
+    // the life of the buffer, and returns the mapping. Writes are seen by
+    // GL commands issued after them, without flushing. Needs
+    // GL_ARB_buffer_storage.
+    void *mapPersistent(size_t len, Type type=ARRAY);
+
+    size_t getSize() const { return size; }
 
 private:
+    size_t size = 0;
+
+    static unsigned int getTarget(Type type);
     void deleteId();
 };
 
@@ -0,0 +1,64 @@
+#include "ChunkFaceMasks.h"
+
+static_assert(Chunk::ZSize == 32, "Rows must fit a uint32_t");
+static_assert(Chunk::XSize == 32 && Chunk::YSize == 32,
+              "Borders must be square and fit a uint32_t");
+
+void ChunkFaceMasks::compute(const Mask &cubes,
+                             const Mask &culling,
+                             const Mask &opaque) {
+    Border empty;
+    empty.fill(0);
+    FaceMap<Border> borders;
+    borders.fill(empty);
+    compute(cubes, culling, opaque, borders);
+}
+
+void ChunkFaceMasks::compute(const Mask &cubes,
+                             const Mask &culling,
+                             const Mask &opaque,
+                             const FaceMap<Border> &borders) {
+    constexpr unsigned int X = Chunk::YSize;  // row stride along x
+    constexpr unsigned int Y = 1;             // row stride along y
+
+    Mask &right = faces[Face::RIGHT];
+    Mask &left = faces[Face::LEFT];
+    Mask &back = faces[Face::BACK];
+    Mask &front = faces[Face::FRONT];
+    Mask &top = faces[Face::TOP];
+    Mask &bottom = faces[Face::BOTTOM];
+
+    // Along z, neighbours are the adjacent bits of the same row, and the
+    // end bits come from the y'th bit of the border rows
+    constexpr unsigned int ZTop = Chunk::ZSize - 1;
+    for (unsigned int r = 0; r < RowCount; r++) {
+        const unsigned int x = r / X, y = r % X;
+        const Row above = (borders[Face::TOP][x] >> y & 1) << ZTop;
+        const Row below = borders[Face::BOTTOM][x] >> y & 1;
+        const Row hidden = culling[r];
+        top[r] = cubes[r] & ~(hidden & ((opaque[r] >> 1) | above));
+        bottom[r] = cubes[r] & ~(hidden & ((opaque[r] << 1) | below));
+    }
+
+    // Along x, neighbours are whole rows X apart
+    for (unsigned int r = 0; r < RowCount - X; r++) {
+        right[r] = cubes[r] & ~(culling[r] & opaque[r + X]);
+        left[r + X] = cubes[r + X] & ~(culling[r + X] & opaque[r]);
+    }
+    for (unsigned int y = 0; y < X; y++) {
+        const unsigned int r = RowCount - X + y;
+        right[r] = cubes[r] & ~(culling[r] & borders[Face::RIGHT][y]);
+        left[y] = cubes[y] & ~(culling[y] & borders[Face::LEFT][y]);
+    }
+
+    // Along y, rows are Y apart but don't wrap into the next x
+    for (unsigned int r = 0; r < RowCount; r++) {
+        const unsigned int x = r / X;
+        const bool last = (r % X) == X - 1;
+        const bool first = (r % X) == 0;
+        const Row behind = last ? borders[Face::BACK][x] : opaque[r + Y];
+        const Row before = first ? borders[Face::FRONT][x] : opaque[r - Y];
+        back[r] = cubes[r] & ~(culling[r] & behind);
+        front[r] = cubes[r] & ~(culling[r] & before);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef CHUNKFACEMASKS_H
+#define CHUNKFACEMASKS_H
+
+#include "util/Face.h"
+#include "Chunk.h"
+
+#include <array>
+#include <cstdint>
+
+// Bitmasks over all the blocks in a chunk, one 32 bit word per (x, y)
+// row with a bit for each z. Whole rows of blocks are tested against
+// their neighbours with a couple of shifts and ANDs, which the compiler
+// is free to vectorize.
+class ChunkFaceMasks {
+public:
+    using Row = uint32_t;
+    static constexpr unsigned int RowCount = Chunk::XSize*Chunk::YSize;
+    using Mask = std::array<Row, RowCount>;
+
+    // The opaque blocks of a neighbouring chunk's layer touching this
+    // chunk, as 32 rows of 32 bits. Rows are indexed by y with z bits for
+    // RIGHT and LEFT, by x with z bits for BACK and FRONT, and by x with
+    // y bits for TOP and BOTTOM.
+    using Border = std::array<Row, Chunk::XSize>;
+
+    static unsigned int rowIndex(int x, int y) { return y + Chunk::YSize*x; }
+    static Row bit(int z) { return Row{1} << z; }
+
+    // cubes are the blocks whose faces may be drawn, culling are the
+    // blocks which hide faces against opaque neighbours (solid blocks)
+    // and opaque are the blocks which hide their neighbours' faces.
+    // Faces on the chunk border are hidden by borders[face], or always
+    // considered exposed when no borders are given.
+    void compute(const Mask &cubes, const Mask &culling, const Mask &opaque);
+    void compute(const Mask &cubes, const Mask &culling, const Mask &opaque,
+                 const FaceMap<Border> &borders);
+
+    const Mask &getFaceMask(Face face) const { return faces[face]; }
+
+private:
+    FaceMap<Mask> faces;
+};
+
+#endif
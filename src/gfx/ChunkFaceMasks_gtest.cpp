@@ -0,0 +1,114 @@
+#include "ChunkFaceMasks.h"
+#include <gtest/gtest.h>
+
+static bool hasFace(const ChunkFaceMasks &masks, Face face, int x, int y, int z) {
+    return (masks.getFaceMask(face)[ChunkFaceMasks::rowIndex(x, y)] &
+            ChunkFaceMasks::bit(z)) != 0;
+}
+
+static void setBlock(ChunkFaceMasks::Mask &mask, int x, int y, int z) {
+    mask[ChunkFaceMasks::rowIndex(x, y)] |= ChunkFaceMasks::bit(z);
+}
+
+TEST(ChunkFaceMasks, SingleCubeHasAllFaces) {
+    ChunkFaceMasks::Mask solid;
+    solid.fill(0);
+    setBlock(solid, 5, 6, 7);
+
+    ChunkFaceMasks masks;
+    masks.compute(solid, solid, solid);
+    for (Face face : all_faces) {
+        EXPECT_TRUE(hasFace(masks, face, 5, 6, 7));
+    }
+}
+
+TEST(ChunkFaceMasks, NeighboursHideSharedFaces) {
+    ChunkFaceMasks::Mask solid;
+    solid.fill(0);
+    setBlock(solid, 5, 5, 5);
+    setBlock(solid, 6, 5, 5);
+    setBlock(solid, 5, 6, 5);
+    setBlock(solid, 5, 5, 6);
+
+    ChunkFaceMasks masks;
+    masks.compute(solid, solid, solid);
+    EXPECT_FALSE(hasFace(masks, Face::RIGHT, 5, 5, 5));
+    EXPECT_FALSE(hasFace(masks, Face::LEFT, 6, 5, 5));
+    EXPECT_FALSE(hasFace(masks, Face::BACK, 5, 5, 5));
+    EXPECT_FALSE(hasFace(masks, Face::FRONT, 5, 6, 5));
+    EXPECT_FALSE(hasFace(masks, Face::TOP, 5, 5, 5));
+    EXPECT_FALSE(hasFace(masks, Face::BOTTOM, 5, 5, 6));
+
+    EXPECT_TRUE(hasFace(masks, Face::LEFT, 5, 5, 5));
+    EXPECT_TRUE(hasFace(masks, Face::FRONT, 5, 5, 5));
+    EXPECT_TRUE(hasFace(masks, Face::BOTTOM, 5, 5, 5));
+}
+
+TEST(ChunkFaceMasks, BorderFacesExposed) {
+    ChunkFaceMasks::Mask solid;
+    solid.fill(~ChunkFaceMasks::Row{0});
+
+    ChunkFaceMasks masks;
+    masks.compute(solid, solid, solid);
+    EXPECT_TRUE(hasFace(masks, Face::LEFT, 0, 3, 3));
+    EXPECT_TRUE(hasFace(masks, Face::RIGHT, 31, 3, 3));
+    EXPECT_TRUE(hasFace(masks, Face::FRONT, 3, 0, 3));
+    EXPECT_TRUE(hasFace(masks, Face::BACK, 3, 31, 3));
+    EXPECT_TRUE(hasFace(masks, Face::BOTTOM, 3, 3, 0));
+    EXPECT_TRUE(hasFace(masks, Face::TOP, 3, 3, 31));
+
+    for (Face face : all_faces) {
+        EXPECT_FALSE(hasFace(masks, face, 3, 3, 3));
+    }
+}
+
+TEST(ChunkFaceMasks, NonCullingCubeKeepsFaces) {
+    ChunkFaceMasks::Mask cubes, culling, opaque;
+    cubes.fill(0);
+    culling.fill(0);
+    opaque.fill(0);
+    // Two see-through cubes next to each other, the first doesn't cull
+    setBlock(cubes, 5, 5, 5);
+    setBlock(cubes, 6, 5, 5);
+    setBlock(culling, 6, 5, 5);
+    setBlock(opaque, 6, 5, 5);
+
+    ChunkFaceMasks masks;
+    masks.compute(cubes, culling, opaque);
+    EXPECT_TRUE(hasFace(masks, Face::RIGHT, 5, 5, 5));
+    EXPECT_TRUE(hasFace(masks, Face::LEFT, 6, 5, 5));
+}
+
+TEST(ChunkFaceMasks, BordersHideFaces) {
+    ChunkFaceMasks::Mask solid;
+    solid.fill(~ChunkFaceMasks::Row{0});
+
+    ChunkFaceMasks::Border border;
+    border.fill(0);
+    FaceMap<ChunkFaceMasks::Border> borders;
+    borders.fill(border);
+    // One opaque block across each face, touching block (0, 0, 0) or
+    // (31, 31, 31) of this chunk
+    borders[Face::LEFT][0] = ChunkFaceMasks::bit(0);
+    borders[Face::FRONT][0] = ChunkFaceMasks::bit(0);
+    borders[Face::BOTTOM][0] = ChunkFaceMasks::bit(0);
+    borders[Face::RIGHT][31] = ChunkFaceMasks::bit(31);
+    borders[Face::BACK][31] = ChunkFaceMasks::bit(31);
+    borders[Face::TOP][31] = ChunkFaceMasks::bit(31);
+
+    ChunkFaceMasks masks;
+    masks.compute(solid, solid, solid, borders);
+    EXPECT_FALSE(hasFace(masks, Face::LEFT, 0, 0, 0));
+    EXPECT_FALSE(hasFace(masks, Face::FRONT, 0, 0, 0));
+    EXPECT_FALSE(hasFace(masks, Face::BOTTOM, 0, 0, 0));
+    EXPECT_FALSE(hasFace(masks, Face::RIGHT, 31, 31, 31));
+    EXPECT_FALSE(hasFace(masks, Face::BACK, 31, 31, 31));
+    EXPECT_FALSE(hasFace(masks, Face::TOP, 31, 31, 31));
+
+    EXPECT_TRUE(hasFace(masks, Face::LEFT, 0, 1, 0));
+    EXPECT_TRUE(hasFace(masks, Face::FRONT, 1, 0, 0));
+    EXPECT_TRUE(hasFace(masks, Face::BOTTOM, 0, 1, 0));
+    EXPECT_TRUE(hasFace(masks, Face::RIGHT, 31, 31, 30));
+    EXPECT_TRUE(hasFace(masks, Face::BACK, 30, 31, 31));
+    EXPECT_TRUE(hasFace(masks, Face::TOP, 31, 30, 31));
+}
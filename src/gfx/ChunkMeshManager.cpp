@@ -1,81 +1,529 @@
 #include "ChunkMeshManager.h"
 #include "tesselate.h"
+#include "gfx/ChunkVertex.h"
+#include "gfx/PlantBlockVisual.h"
+#include <GL/glew.h>
+#include <algorithm>
 #include <iostream>
 
-ChunkMeshManager::ChunkMeshManager(ThreadManager &tm, BlockVisualRegistry blockvisuals) :
-    tm(tm), blockvisuals(std::move(blockvisuals))
+static MeshBuilder buildPlantMesh() {
+    MeshBuilder builder;
+    PlantBlockVisual::buildInstanceMesh(builder);
+    return builder;
+}
+
+ChunkMeshManager::ChunkMeshManager(ThreadManager &tm,
+                                   BlockVisualRegistry blockvisuals,
+                                   const BlockTypeRegistry &blocktypes) :
+    tm(tm),
+    blockvisuals(std::move(blockvisuals)),
+    // Chunk meshes are all quads, so the index buffer only comes into
+    // use for visuals that write their own indices
+    arena(this->blockvisuals.getGeometry() == ChunkGeometry::FACES ?
+          chunkFaceFormat() : chunkMeshFormat(),
+          ArenaVertices, 1 << 10, 8 << 20),
+    plant_arena(buildPlantMesh(), plantInstanceFormat(), 1 << 16),
+    mesh_pool(64),
+    shared_meshes([this](const ArenaMesh &mesh) {
+                      addMeshStats(mesh);
+                      stats.shared_meshes.add();
+                  },
+                  // Deleted on the main thread, which drops the last
+                  // reference, as workers only ever hold meshes on their
+                  // way to the main thread
+                  [this](const ArenaMesh &mesh) {
+                      removeMeshStats(mesh);
+                      stats.shared_meshes.sub();
+                  }),
+    remesh_latency(120),
+    upload_times(120)
 {
-    this->blockvisuals.prepareTesselate();
+    this->blockvisuals.prepareTesselate(blocktypes);
+    if (getGeometry() == ChunkGeometry::FACES) {
+        // A record's four 16 bit vertices make up one texel
+        arena.setVertexTexture(GL_RG32UI);
+        // Meshes are evicted well before the arena would have to grow
+        // past what the texture can show, leaving it room to fragment
+        const size_t max_bytes = arena.getMaxVertices() * arena.getFormat().getVertexSize();
+        budget.bytes = std::min(budget.bytes, max_bytes / 2);
+    }
 }
 
-const Mesh *ChunkMeshManager::getMesh(const glm::ivec3 &pos) const {
-    // updateMesh doesn't modify anything if chunk is empty
-    return const_cast<ChunkMeshManager *>(this)->updateMesh(
-        pos, std::shared_ptr<const Chunk>());
+bool ChunkMeshManager::canDrawFaces() {
+    return MeshArena::getMaxTextureBufferBytes(GL_RG32UI) >=
+        ArenaVertices * chunkFaceFormat().getVertexSize();
 }
 
-const Mesh *ChunkMeshManager::updateMesh(const glm::ivec3 &pos,
-                                         const std::shared_ptr<const Chunk> &chunk) {
+const ChunkMeshManager::SectionMeshes *ChunkMeshManager::getMesh(const glm::ivec3 &pos) const {
+    auto iter = meshmap.find(pos);
+    if (iter == meshmap.end()) {
+        return nullptr;
+    }
+    return &iter->second.sections;
+}
+
+const ChunkMeshManager::SectionMeshes *ChunkMeshManager::updateMesh(
+    const glm::ivec3 &pos,
+    const ChunkNeighborhood &neighborhood,
+    int lod)
+{
     // Find mesh in our cache
     auto iter = meshmap.find(pos);
     if (iter == meshmap.end()) {
-        if (chunk) {
+        if (neighborhood.chunk) {
             // If we don't have it, generate it but in the mean time return null
-            asyncGenerateMesh(pos, chunk);
+            stats.misses.add();
+            asyncGenerateMesh(pos, neighborhood, lod);
         }
         
         return nullptr;
     }
 
-    const Entry &entry = iter->second;
+    Entry &entry = iter->second;
+    if (neighborhood.chunk) {
+        stats.hits.add();
+    }
+    refreshMesh(entry, neighborhood, lod);
+    touch(entry);
+    
+    // Return the meshes we found
+    return &entry.sections;
+}
+
+void ChunkMeshManager::prefetchMesh(const glm::ivec3 &pos,
+                                    const ChunkNeighborhood &neighborhood,
+                                    int lod)
+{
+    if (!neighborhood.chunk ||
+        static_cast<size_t>(stats.mesh_bytes.get()) >= budget.bytes) {
+        return;
+    }
 
-    if (chunk && entry.chunkptr.lock() != chunk) {
-        // If the mesh is not for this chunk, regenerate it.
-        // In this case, we're returning a stale mesh, hopefully not for long.
-        asyncGenerateMesh(pos, chunk);
+    auto iter = meshmap.find(pos);
+    if (iter == meshmap.end()) {
+        asyncGenerateMesh(pos, neighborhood, lod);
+    } else {
+        refreshMesh(iter->second, neighborhood, lod);
     }
+}
 
-    // Reset entries idle counter to zero
-    entry.idlectr = 0;
-    
-    // Return the mesh we found
-    return &entry.mesh;
+void ChunkMeshManager::refreshMesh(Entry &entry,
+                                   const ChunkNeighborhood &neighborhood,
+                                   int lod)
+{
+    if (neighborhood.chunk && !entry.deps.matches(neighborhood)) {
+        // If the mesh is not for this chunk and its current neighbours,
+        // regenerate it. In this case, we're returning a stale mesh,
+        // hopefully not for long.
+        if (entry.dirty_since == Clock::time_point{}) {
+            entry.dirty_since = Clock::now();
+        }
+        asyncGenerateMesh(entry.pos, neighborhood, lod);
+    } else if (neighborhood.chunk && entry.lod != lod) {
+        // Likewise, the old level of detail is drawn until the new one lands
+        asyncGenerateMesh(entry.pos, neighborhood, lod);
+    }
+}
+
+ChunkVisibility ChunkMeshManager::getVisibility(const glm::ivec3 &pos) const {
+    auto iter = meshmap.find(pos);
+    if (iter == meshmap.end()) {
+        return ChunkVisibility{};
+    }
+    return iter->second.visibility;
+}
+
+const ChunkOccluder *ChunkMeshManager::getOccluder(const glm::ivec3 &pos) const {
+    auto iter = meshmap.find(pos);
+    if (iter == meshmap.end()) {
+        return nullptr;
+    }
+    return &iter->second.occluder;
 }
 
 void ChunkMeshManager::asyncGenerateMesh(const glm::ivec3 &pos,
-                                         std::shared_ptr<const Chunk> chunk) {
-    if (meshgen_pending.count(chunk))
+                                         ChunkNeighborhood neighborhood,
+                                         int lod) {
+    // One build per position at a time. If the neighbourhood changes in
+    // the mean time, the next updateMesh after this one lands notices.
+    if (meshgen_pending.count(pos))
         return;
-    meshgen_pending.insert(chunk);
+    meshgen_pending.insert(pos);
+    stats.pending.add();
+
+    // Sections are only rebuilt if the blocks they read have changed
+    auto iter = meshmap.find(pos);
+    SectionHashes old_hashes{};
+    SectionMeshHashes old_mesh_hashes{};
+    bool have_hashes = iter != meshmap.end() && iter->second.lod == lod;
+    if (have_hashes) {
+        old_hashes = iter->second.hashes;
+        old_mesh_hashes = iter->second.mesh_hashes;
+    }
+    // Visibility and occluders only depend on the chunk's own blocks, at
+    // full detail
+    const bool chunk_changed = iter == meshmap.end() ||
+        iter->second.deps.chunkptr.lock() != neighborhood.chunk;
+    const bool had_entry = iter != meshmap.end();
+
+    tm.postWork([=, neighborhood = std::move(neighborhood)](WorkerThread &wt) {
+        struct SectionUpdate {
+            int section;
+            bool rebuild_mesh;
+            MeshTable::Key mesh_key;
+            // An existing mesh with the same contents, or a new one if
+            // this update claimed building it, or neither if another
+            // update is building it
+            SharedMesh shared;
+            bool building;
+            MeshUpload mesh;
+            std::vector<PlantInstance> plants;
+            int left_out;
+        };
+        // Shared, since uploads can't be copied into the std::function
+        auto updates = std::make_shared<std::vector<SectionUpdate>>();
 
-    tm.postWork([=, chunk = std::move(chunk)](WorkerThread &wt) {
+        // Distant chunks are meshed from downsampled copies, neighbours
+        // included, so that they cull against each other without cracks
+        ChunkNeighborhood meshed = neighborhood;
+        if (lod > 0) {
+            const int factor = 1 << lod;
+            meshed.chunk = blockvisuals.downsample(*meshed.chunk, factor);
+            for (Face face : all_faces) {
+                auto &neighbor = meshed.neighbors[face];
+                if (neighbor) {
+                    neighbor = blockvisuals.downsample(*neighbor, factor);
+                }
+            }
+            for (auto &diagonal : meshed.diagonals) {
+                if (diagonal) {
+                    diagonal = blockvisuals.downsample(*diagonal, factor);
+                }
+            }
+        }
+
+        ChunkVisibility visibility;
+        ChunkOccluder occluder;
+        if (chunk_changed) {
+            const auto opaque = blockvisuals.getOpaqueMask(*neighborhood.chunk);
+            visibility = ChunkVisibility::compute(opaque);
+            occluder = ChunkOccluder::compute(opaque);
+        }
+
+        SectionHashes hashes;
+        SectionMeshHashes mesh_hashes = old_mesh_hashes;
         auto &builder = wt.cacheLocal<MeshBuilder>("MeshBuilder");
-        blockvisuals.tesselate(builder, *chunk);
+        for (int section = 0; section < BlockVisualRegistry::SectionCount; section++) {
+            hashes[section] = BlockVisualRegistry::hashSection(meshed, section);
+            if (have_hashes && hashes[section] == old_hashes[section]) {
+                continue;
+            }
+
+            // Plants coming and going leave the rest of the mesh as it
+            // was, so only their instances need replacing
+            SectionUpdate update;
+            update.section = section;
+            mesh_hashes[section] = blockvisuals.hashSectionMesh(meshed, section);
+            update.rebuild_mesh = !have_hashes ||
+                mesh_hashes[section] != old_mesh_hashes[section];
+            update.mesh_key = getMeshKey(mesh_hashes[section], section);
+            update.building = false;
+            if (update.rebuild_mesh) {
+                update.shared = shared_meshes.claim(update.mesh_key, update.building);
+            }
+            if (update.building) {
+                // The mesh is moved out of the builder, which carries on
+                // with a recycled spare, and written straight into mapped
+                // memory from here, so the main thread only has to queue
+                // a copy
+                blockvisuals.tesselateSection(builder, meshed, section, &update.plants);
+                update.mesh = arena.stage(builder.takeData(mesh_pool.take()));
+            } else {
+                blockvisuals.findPlants(update.plants, *meshed.chunk, section);
+            }
+            update.left_out = blockvisuals.countLeftOut(*meshed.chunk, section);
+            updates->push_back(std::move(update));
+        }
+
         tm.postMain([=,
-		     chunk = std::move(chunk)]() {
-            std::cout << "Uploading mesh at "
+		     neighborhood = std::move(neighborhood)]() {
+            const auto start = Clock::now();
+            std::cout << "Uploading " << updates->size()
+                      << " mesh sections at "
                       << pos.x << ","
-                      << pos.y << std::endl;
-            Entry &entry = meshmap[pos];
-            entry.mesh = builder.build();
-            entry.chunkptr = chunk;
-            entry.idlectr = 0;
-            meshgen_pending.erase(chunk);
+                      << pos.y << ","
+                      << pos.z << std::endl;
+            auto iter = meshmap.find(pos);
+            if (iter == meshmap.end() && had_entry) {
+                // Evicted in the mean time, leaving nothing for these
+                // updates to apply to. The next updateMesh starts over.
+                // Shared meshes must be let go of here, on the main thread.
+                for (const auto &update : *updates) {
+                    if (update.building) {
+                        std::vector<MeshWaiter> waiters;
+                        shared_meshes.release(update.mesh_key, waiters);
+                        resolveWaiters(update.mesh_key, nullptr, waiters);
+                    }
+                }
+                updates->clear();
+                meshgen_pending.erase(pos);
+                stats.pending.sub();
+                return;
+            }
+            Entry &entry = iter != meshmap.end() ? iter->second : insertEntry(pos);
+            long built = 0, shared = 0;
+            std::vector<int> unresolved;
+            struct Resolved {
+                MeshTable::Key key;
+                SharedMesh mesh;
+                std::vector<MeshWaiter> waiters;
+            };
+            std::vector<Resolved> resolved;
+            for (auto &update : *updates) {
+                SectionMesh &section = entry.sections[update.section];
+                removeStats(section);
+                if (update.building) {
+                    std::vector<MeshWaiter> waiters;
+                    section.mesh = shared_meshes.share(update.mesh_key,
+                                                       arena.allocate(update.mesh),
+                                                       waiters);
+                    mesh_pool.recycle(update.mesh.takeData());
+                    resolved.push_back(Resolved{update.mesh_key, section.mesh, std::move(waiters)});
+                    built++;
+                } else if (update.rebuild_mesh) {
+                    if (!update.shared) {
+                        // Built for another chunk, which may have landed
+                        // by now
+                        update.shared = shared_meshes.find(update.mesh_key);
+                    }
+                    if (update.shared) {
+                        section.mesh = std::move(update.shared);
+                        shared++;
+                    } else if (!shared_meshes.wait(update.mesh_key,
+                                                   MeshWaiter{pos, update.section})) {
+                        // Nobody's building it any more, so this section
+                        // has to try again
+                        unresolved.push_back(update.section);
+                    }
+                }
+                section.plants = plant_arena.allocate(update.plants);
+                section.left_out = update.left_out;
+                addStats(section);
+            }
+            stats.sections_built.add(built);
+            stats.sections_shared.add(shared);
+            stats.sections_replanted.add(updates->size() - built - shared);
+            stats.sections_skipped.add(BlockVisualRegistry::SectionCount - updates->size());
+            updates->clear();
+
+            if (entry.dirty_since != Clock::time_point{}) {
+                std::chrono::duration<float, std::milli> latency =
+                    Clock::now() - entry.dirty_since;
+                remesh_latency.add(latency.count());
+                entry.dirty_since = Clock::time_point{};
+            }
+
+            entry.hashes = hashes;
+            entry.mesh_hashes = mesh_hashes;
+            if (chunk_changed) {
+                entry.visibility = visibility;
+                entry.occluder = occluder;
+            }
+            entry.deps = Dependencies{neighborhood};
+            if (!unresolved.empty()) {
+                // Forget the sections that didn't get their meshes, and
+                // the neighbourhood, so that the next updateMesh comes
+                // back for them
+                for (int section : unresolved) {
+                    entry.hashes[section] = 0;
+                    entry.mesh_hashes[section] = BlockVisualRegistry::MeshHash{};
+                }
+                entry.deps = Dependencies{};
+            }
+            entry.lod = lod;
+            touch(entry);
+            meshgen_pending.erase(pos);
+            stats.pending.sub();
+
+            // Only once this entry is in place, as its own sections may
+            // be among those waiting
+            for (const Resolved &done : resolved) {
+                resolveWaiters(done.key, done.mesh, done.waiters);
+            }
+
+            const std::chrono::duration<float, std::milli> time = Clock::now() - start;
+            upload_times.add(time.count());
         });
     });
 }
 
-void ChunkMeshManager::freeUnusedMeshes() {
-    for (auto i = std::begin(meshmap); i != std::end(meshmap); ) {
-        Entry &entry = i->second;
-        if (entry.chunkptr.expired() && entry.idlectr > 100) {
-            std::cout << "Erasing mesh at "
-                      << i->first.x << ","
-                      << i->first.y << std::endl;
-            i = meshmap.erase(i);
+void ChunkMeshManager::retireUploads() {
+    arena.retireUploads();
+}
+
+void ChunkMeshManager::evictMeshes() {
+    while (lru_tail && lru_tail->last_used != frame) {
+        const bool over_budget = static_cast<size_t>(stats.mesh_bytes.get()) > budget.bytes;
+        const bool idle = frame - lru_tail->last_used > budget.idle_frames;
+        if (!over_budget && !idle) {
+            break;
+        }
+
+        std::cout << "Erasing mesh at "
+                  << lru_tail->pos.x << ","
+                  << lru_tail->pos.y << std::endl;
+        eraseEntry(*lru_tail);
+        stats.evictions.add();
+    }
+
+    frame++;
+}
+
+ChunkMeshManager::Entry &ChunkMeshManager::insertEntry(const glm::ivec3 &pos) {
+    Entry &entry = meshmap[pos];
+    entry.pos = pos;
+    entry.last_used = frame;
+    entry.lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = &entry;
+    } else {
+        lru_tail = &entry;
+    }
+    lru_head = &entry;
+    return entry;
+}
+
+void ChunkMeshManager::touch(Entry &entry) {
+    entry.last_used = frame;
+    if (lru_head == &entry) {
+        return;
+    }
+
+    unlink(entry);
+    entry.lru_next = lru_head;
+    lru_head->lru_prev = &entry;
+    lru_head = &entry;
+}
+
+void ChunkMeshManager::unlink(Entry &entry) {
+    if (entry.lru_prev) {
+        entry.lru_prev->lru_next = entry.lru_next;
+    } else {
+        lru_head = entry.lru_next;
+    }
+    if (entry.lru_next) {
+        entry.lru_next->lru_prev = entry.lru_prev;
+    } else {
+        lru_tail = entry.lru_prev;
+    }
+    entry.lru_prev = entry.lru_next = nullptr;
+}
+
+void ChunkMeshManager::eraseEntry(Entry &entry) {
+    unlink(entry);
+    for (const SectionMesh &section : entry.sections) {
+        removeStats(section);
+    }
+    meshmap.erase(entry.pos);
+}
+
+ChunkMeshManager::MeshTable::Key ChunkMeshManager::getMeshKey(
+    const BlockVisualRegistry::MeshHash &mesh_hash,
+    int section)
+{
+    // Meshes are in chunk coordinates, so the same blocks in different
+    // sections give different meshes
+    return MeshTable::Key{
+        (mesh_hash.hash ^ static_cast<uint64_t>(section)) * 1099511628211ull,
+        (mesh_hash.check ^ static_cast<uint64_t>(section)) * 0xc4ceb9fe1a85ec53ull};
+}
+
+void ChunkMeshManager::resolveWaiters(const MeshTable::Key &key,
+                                      const SharedMesh &mesh,
+                                      const std::vector<MeshWaiter> &waiters) {
+    for (const MeshWaiter &waiter : waiters) {
+        auto iter = meshmap.find(waiter.pos);
+        if (iter == meshmap.end()) {
+            continue;
+        }
+        // Unless the section has moved on to other blocks since
+        Entry &entry = iter->second;
+        if (getMeshKey(entry.mesh_hashes[waiter.section], waiter.section) != key) {
+            continue;
+        }
+
+        if (mesh) {
+            SectionMesh &section = entry.sections[waiter.section];
+            removeStats(section);
+            section.mesh = mesh;
+            addStats(section);
+            stats.sections_shared.add();
         } else {
-            entry.idlectr++;
-            ++i;
+            // As for sections that found nobody building their mesh
+            entry.hashes[waiter.section] = 0;
+            entry.mesh_hashes[waiter.section] = BlockVisualRegistry::MeshHash{};
+            entry.deps = Dependencies{};
+        }
+    }
+}
+
+void ChunkMeshManager::addStats(const SectionMesh &section) {
+    stats.mesh_bytes.add(section.plants.getBytes());
+    stats.plants.add(section.plants.getCount());
+    stats.blocks_left_out.add(section.left_out);
+}
+
+void ChunkMeshManager::removeStats(const SectionMesh &section) {
+    stats.mesh_bytes.sub(section.plants.getBytes());
+    stats.plants.sub(section.plants.getCount());
+    stats.blocks_left_out.sub(section.left_out);
+}
+
+void ChunkMeshManager::addMeshStats(const ArenaMesh &mesh) {
+    const size_t bytes = mesh.getVertexBytes() + mesh.getIndexBytes();
+    stats.mesh_bytes.add(bytes);
+    if (mesh) {
+        stats.meshes.add();
+        stats.vertex_bytes.add(mesh.getVertexBytes());
+        stats.index_bytes.add(mesh.getIndexBytes());
+    }
+}
+
+void ChunkMeshManager::removeMeshStats(const ArenaMesh &mesh) {
+    const size_t bytes = mesh.getVertexBytes() + mesh.getIndexBytes();
+    stats.mesh_bytes.sub(bytes);
+    if (mesh) {
+        stats.meshes.sub();
+        stats.vertex_bytes.sub(mesh.getVertexBytes());
+        stats.index_bytes.sub(mesh.getIndexBytes());
+    }
+}
+
+ChunkMeshManager::Dependencies::Dependencies(const ChunkNeighborhood &neighborhood) :
+    chunkptr(neighborhood.chunk)
+{
+    for (Face face : all_faces) {
+        neighborptrs[face] = neighborhood.neighbors[face];
+    }
+    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+        diagonalptrs[i] = neighborhood.diagonals[i];
+    }
+}
+
+bool ChunkMeshManager::Dependencies::matches(const ChunkNeighborhood &neighborhood) const {
+    if (chunkptr.lock() != neighborhood.chunk) {
+        return false;
+    }
+
+    for (Face face : all_faces) {
+        if (neighborptrs[face].lock() != neighborhood.neighbors[face]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+        if (diagonalptrs[i].lock() != neighborhood.diagonals[i]) {
+            return false;
         }
     }
+    return true;
 }
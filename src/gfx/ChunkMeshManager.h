@@ -2,45 +2,242 @@
 #define CHUNKMESHMANAGER_H
 
 #include "Chunk.h"
+#include "ChunkNeighborhood.h"
 #include "util/ThreadManager.h"
 #include "util/math.h"
+#include "util/Counter.h"
+#include "util/SampleWindow.h"
 #include "gfx/BlockVisualRegistry.h"
 #include "gfx/Mesh.h"
+#include "gfx/MeshArena.h"
+#include "gfx/InstanceArena.h"
+#include "gfx/MeshDataPool.h"
+#include "gfx/MeshShareTable.h"
+#include "gfx/ChunkVisibility.h"
+#include "gfx/OcclusionBuffer.h"
 
+#include <array>
 #include <vector>
 #include <utility>
 #include <chrono>
-#include <set>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
 
 class ChunkMeshManager {
 public:
-    ChunkMeshManager(ThreadManager &tm, BlockVisualRegistry blockvisuals);
+    ChunkMeshManager(ThreadManager &tm,
+                     BlockVisualRegistry blockvisuals,
+                     const BlockTypeRegistry &blocktypes);
 
-    const Mesh *getMesh(const glm::ivec3 &pos) const;
-    const Mesh *updateMesh(const glm::ivec3 &pos,
-                           const std::shared_ptr<const Chunk> &chunk);
+    // One mesh per section of the chunk, all in the shared arena, and the
+    // section's plants, drawn as instances of one shared mesh. Sections
+    // with the same blocks, their borders included, share one mesh
+    // (underground stone, open sky, ...), so only the first of them is
+    // tesselated. Meshes may be empty, or missing for sections not yet
+    // meshed.
+    using SharedMesh = std::shared_ptr<const ArenaMesh>;
+    struct SectionMesh {
+        SharedMesh mesh;
+        ArenaInstances plants;
+        // See BlockVisualRegistry::countLeftOut
+        int left_out = 0;
+    };
+    using SectionMeshes = std::array<SectionMesh, BlockVisualRegistry::SectionCount>;
+
+    // Level of detail n meshes chunks downsampled by 2^n, see
+    // BlockVisualRegistry::downsample
+    static constexpr int LODCount = 3;
+
+    // The meshes as they are, without building them or counting them as
+    // used
+    const SectionMeshes *getMesh(const glm::ivec3 &pos) const;
+    // Likewise, but rebuilds the sections whose blocks differ from the
+    // snapshots they were last built from, including the border blocks
+    // of neighbours, or all of them when the level of detail changes,
+    // and counts the meshes as used this frame (see Budget). Neighbours should
+    // be left out of the neighbourhood if they're drawn at a different
+    // level of detail, so that the border faces are kept to cover seams.
+    const SectionMeshes *updateMesh(const glm::ivec3 &pos,
+                                    const ChunkNeighborhood &neighborhood,
+                                    int lod);
+    // Likewise, without counting the meshes as used, and only while
+    // under the budget. For chunks that may come into view, so that
+    // they're ready when they do.
+    void prefetchMesh(const glm::ivec3 &pos,
+                      const ChunkNeighborhood &neighborhood,
+                      int lod);
+
+    // Which faces of the chunk see each other, as of its last mesh. Only
+    // recomputed when the chunk itself changes. Chunks without meshes
+    // see through everywhere.
+    ChunkVisibility getVisibility(const glm::ivec3 &pos) const;
+    // Likewise the chunk's solid ground, or null for chunks without meshes
+    const ChunkOccluder *getOccluder(const glm::ivec3 &pos) const;
+
+    MeshArena &getArena() { return arena; }
+    const MeshArena &getArena() const { return arena; }
+    InstanceArena &getPlantArena() { return plant_arena; }
+    const InstanceArena &getPlantArena() const { return plant_arena; }
+
+    // As set on the BlockVisualRegistry it was given. With FACES, the
+    // arena's vertex texture holds the face records.
+    ChunkGeometry getGeometry() const { return blockvisuals.getGeometry(); }
+    // Whether the GL context's buffer textures are big enough for FACES.
+    // GL only promises 64K texels, short of the arena's starting size.
+    static bool canDrawFaces();
 
     // TODO delete me after Meshes have textures
     const ArrayTexture &getBlockTex() { return blockvisuals.getBlockTex(); }
     
-    void freeUnusedMeshes();
-    
+    // Meshes are kept in least recently used order, by the last frame
+    // updateMesh asked for them. Past the byte budget, or once unused for
+    // idle_frames, the least recently used are freed, but never one that
+    // was used this frame, so the budget is only exceeded when the meshes
+    // used in a single frame need more. WorldView only asks for the
+    // chunks its visibility walk reaches, so meshes outside the frustum
+    // or walled off go first, and are only prefetched again while
+    // there's room.
+    struct Budget {
+        size_t bytes = size_t{512} << 20;
+        long idle_frames = 3600;
+    };
+    Budget &getBudget() { return budget; }
+    const Budget &getBudget() const { return budget; }
+
+    // Frees meshes as per the budget, in time proportional to the number
+    // freed, and starts the next frame. Call once a frame.
+    void evictMeshes();
+
+    struct Stats {
+        Counter meshes;
+        Counter pending;
+        Counter vertex_bytes;
+        Counter index_bytes;
+        // GPU bytes of all the meshes, plants included, as counted
+        // against the budget
+        Counter mesh_bytes;
+        // updateMesh calls that found a mesh, stale or not, and that
+        // didn't
+        Counter hits;
+        Counter misses;
+        Counter evictions;
+        Counter sections_built;
+        Counter sections_skipped;
+        // Sections given an existing mesh with the same contents, rather
+        // than tesselated
+        Counter sections_shared;
+        Counter shared_meshes;
+        // Sections whose plants changed, but not their mesh
+        Counter sections_replanted;
+        Counter plants;
+        // Blocks missing from the meshes, as face records can't hold
+        // custom visuals, see BlockVisualRegistry::setGeometry
+        Counter blocks_left_out;
+    };
+    const Stats &getStats() const { return stats; }
+
+    // Milliseconds from noticing a changed chunk to its sections being
+    // uploaded, over recent rebuilds of existing meshes
+    const SampleWindow &getRemeshLatency() const { return remesh_latency; }
+    // Milliseconds the main thread spends putting a chunk's new sections
+    // in place, over recent uploads. Mesh data is written by the workers
+    // into mapped memory where supported, leaving the main thread just to
+    // queue copies on the GPU.
+    const SampleWindow &getUploadTimes() const { return upload_times; }
+
+    // Frees up the staging memory of uploads the GPU has finished with.
+    // Call once a frame.
+    void retireUploads();
+
 private:
     ThreadManager &tm;
     BlockVisualRegistry blockvisuals;
+    // Before meshmap, so they outlive the meshes in them
+    static constexpr size_t ArenaVertices = 1 << 20;
+    MeshArena arena;
+    InstanceArena plant_arena;
+    // Buffers for the workers' meshes, handed back once uploaded
+    MeshDataPool mesh_pool;
+
+    // Every mesh in use, by getMeshKey, and the keys of those being built,
+    // with the sections waiting on them. Looked up by the workers, and
+    // before meshmap, so that it outlives the meshes.
+    struct MeshWaiter {
+        glm::ivec3 pos;
+        int section;
+    };
+    using MeshTable = MeshShareTable<ArenaMesh, MeshWaiter>;
+    MeshTable shared_meshes;
+    // Likewise, as freeing meshes updates it
+    Stats stats;
+
+    static MeshTable::Key getMeshKey(const BlockVisualRegistry::MeshHash &mesh_hash, int section);
+    // Gives the sections that waited on key its mesh, or if it was never
+    // shared, has them built again
+    void resolveWaiters(const MeshTable::Key &key,
+                        const SharedMesh &mesh,
+                        const std::vector<MeshWaiter> &waiters);
 
     void asyncGenerateMesh(const glm::ivec3 &pos,
-                           std::shared_ptr<const Chunk> chunk);
-    
-    struct Entry {
-        Mesh mesh;
+                           ChunkNeighborhood neighborhood,
+                           int lod);
+
+    // Weak so that meshes don't keep their chunks, or their neighbours,
+    // loaded
+    struct Dependencies {
         std::weak_ptr<const Chunk> chunkptr;
-        mutable int idlectr;
+        FaceMap<std::weak_ptr<const Chunk>> neighborptrs;
+        std::array<std::weak_ptr<const Chunk>, ChunkNeighborhood::DiagonalCount> diagonalptrs;
+
+        Dependencies() = default;
+        explicit Dependencies(const ChunkNeighborhood &neighborhood);
+        bool matches(const ChunkNeighborhood &neighborhood) const;
+    };
+
+    using Clock = std::chrono::steady_clock;
+    using SectionHashes = std::array<uint64_t, BlockVisualRegistry::SectionCount>;
+    using SectionMeshHashes = std::array<BlockVisualRegistry::MeshHash,
+                                         BlockVisualRegistry::SectionCount>;
+
+    struct Entry {
+        glm::ivec3 pos;
+        SectionMeshes sections;
+        SectionHashes hashes;
+        // See BlockVisualRegistry::hashSectionMesh
+        SectionMeshHashes mesh_hashes;
+        ChunkVisibility visibility;
+        ChunkOccluder occluder;
+        Dependencies deps;
+        int lod;
+        Clock::time_point dirty_since;
+
+        // Intrusive links for the LRU list. Entries stay put in meshmap,
+        // whose nodes never move.
+        Entry *lru_prev = nullptr;
+        Entry *lru_next = nullptr;
+        long last_used = 0;
     };
     std::unordered_map<glm::ivec3, Entry> meshmap;
-    // TODO unordered
-    std::set<std::shared_ptr<const Chunk>> meshgen_pending;
+    // Most recently used first
+    Entry *lru_head = nullptr;
+    Entry *lru_tail = nullptr;
+    long frame = 0;
+    Budget budget;
+
+    void refreshMesh(Entry &entry, const ChunkNeighborhood &neighborhood, int lod);
+    Entry &insertEntry(const glm::ivec3 &pos);
+    void touch(Entry &entry);
+    void unlink(Entry &entry);
+    void eraseEntry(Entry &entry);
+    std::unordered_set<glm::ivec3> meshgen_pending;
+
+    SampleWindow remesh_latency;
+    SampleWindow upload_times;
+    void addStats(const SectionMesh &section);
+    void removeStats(const SectionMesh &section);
+    void addMeshStats(const ArenaMesh &mesh);
+    void removeMeshStats(const ArenaMesh &mesh);
 };
 
 #endif
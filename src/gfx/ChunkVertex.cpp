@@ -0,0 +1,126 @@
+#include "ChunkVertex.h"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+MeshFormat chunkMeshFormat() {
+    using Type = MeshFormat::Type;
+    using Mode = MeshFormat::Mode;
+    return MeshFormat{
+        {4, Type::UNSIGNED_BYTE, Mode::INTEGER},
+        {4, Type::UNSIGNED_BYTE, Mode::INTEGER}};
+}
+
+MeshFormat chunkFaceFormat() {
+    return MeshFormat{
+        {1, MeshFormat::Type::UNSIGNED_SHORT, MeshFormat::Mode::INTEGER}};
+}
+
+MeshFormat plantInstanceFormat() {
+    return MeshFormat{
+        {4, MeshFormat::Type::UNSIGNED_BYTE, MeshFormat::Mode::INTEGER}};
+}
+
+uint8_t chunkShade(ChunkNormal normal, int occlusion) {
+    using Shades = std::array<std::array<uint8_t, 4>, 10>;
+    static const Shades shades = []() {
+        // As vert.glsl's table, in the same order
+        const glm::vec3 normals[] = {
+            {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+            {0.70710678f, -0.70710678f, 0}, {-0.70710678f, 0.70710678f, 0},
+            {-0.70710678f, -0.70710678f, 0}, {0.70710678f, 0.70710678f, 0}};
+        const glm::vec3 sundir = glm::normalize(glm::vec3{.3f, .5f, -1});
+        const float occlusion_light[] = {1, .8f, .65f, .5f};
+
+        Shades shades;
+        for (int n = 0; n < 10; n++) {
+            const float sun = std::min(std::max(-glm::dot(normals[n], sundir), .2f), 1.f);
+            for (int o = 0; o < 4; o++) {
+                shades[n][o] = static_cast<uint8_t>(std::round(255*sun*occlusion_light[o]));
+            }
+        }
+        return shades;
+    }();
+
+    assert(occlusion >= 0 && occlusion <= 3);
+    return shades[static_cast<int>(normal)][occlusion];
+}
+
+MeshBuilder::Index makeChunkVert(MeshBuilder &builder,
+                                 const glm::ivec3 &pos,
+                                 ChunkNormal normal,
+                                 const glm::ivec3 &tex,
+                                 uint8_t shade) {
+    assert(pos.x >= 0 && pos.x <= 255 &&
+           pos.y >= 0 && pos.y <= 255 &&
+           pos.z >= 0 && pos.z <= 255);
+    assert(tex.x >= 0 && tex.x <= 255 &&
+           tex.y >= 0 && tex.y <= 255 &&
+           tex.z >= 0 && tex.z <= 255);
+
+    builder.append(static_cast<uint8_t>(pos.x));
+    builder.append(static_cast<uint8_t>(pos.y));
+    builder.append(static_cast<uint8_t>(pos.z));
+    builder.append(static_cast<uint8_t>(normal));
+    builder.append(static_cast<uint8_t>(tex.x));
+    builder.append(static_cast<uint8_t>(tex.y));
+    builder.append(static_cast<uint8_t>(tex.z));
+    builder.append(shade);
+    return builder.finishVert();
+}
+
+MeshBuilder::Index makeChunkQuad(MeshBuilder &builder,
+                                 const std::array<glm::ivec3, 4> &pos,
+                                 ChunkNormal normal,
+                                 const std::array<glm::ivec3, 4> &tex,
+                                 const std::array<uint8_t, 4> &shades) {
+    using Attribute = std::array<uint8_t, 4>;
+    std::array<Attribute, 4> pos_attrs, tex_attrs;
+    for (int i = 0; i < 4; i++) {
+        assert(pos[i].x >= 0 && pos[i].x <= 255 &&
+               pos[i].y >= 0 && pos[i].y <= 255 &&
+               pos[i].z >= 0 && pos[i].z <= 255);
+        assert(tex[i].x >= 0 && tex[i].x <= 255 &&
+               tex[i].y >= 0 && tex[i].y <= 255 &&
+               tex[i].z >= 0 && tex[i].z <= 255);
+
+        pos_attrs[i] = Attribute{{static_cast<uint8_t>(pos[i].x),
+                                  static_cast<uint8_t>(pos[i].y),
+                                  static_cast<uint8_t>(pos[i].z),
+                                  static_cast<uint8_t>(normal)}};
+        tex_attrs[i] = Attribute{{static_cast<uint8_t>(tex[i].x),
+                                  static_cast<uint8_t>(tex[i].y),
+                                  static_cast<uint8_t>(tex[i].z),
+                                  shades[i]}};
+    }
+    return builder.appendQuad(pos_attrs, tex_attrs);
+}
+
+MeshBuilder::Index makeChunkFace(MeshBuilder &builder,
+                                 const glm::ivec3 &origin,
+                                 Face face,
+                                 int width, int height,
+                                 unsigned int layer,
+                                 uint8_t occlusion,
+                                 bool flipped) {
+    assert(origin.x >= 0 && origin.x <= 63 &&
+           origin.y >= 0 && origin.y <= 63 &&
+           origin.z >= 0 && origin.z <= 63);
+    assert(width >= 1 && width <= 32 && height >= 1 && height <= 32);
+    assert(layer <= 255);
+
+    const uint32_t lo =
+        static_cast<uint32_t>(origin.x) |
+        static_cast<uint32_t>(origin.y) << 6 |
+        static_cast<uint32_t>(origin.z) << 12 |
+        static_cast<uint32_t>(face) << 18 |
+        static_cast<uint32_t>(width - 1) << 21 |
+        static_cast<uint32_t>(height - 1) << 26 |
+        static_cast<uint32_t>(flipped) << 31;
+    const uint32_t hi = layer | static_cast<uint32_t>(occlusion) << 8;
+
+    const std::array<uint16_t, 4> words{{
+        static_cast<uint16_t>(lo), static_cast<uint16_t>(lo >> 16),
+        static_cast<uint16_t>(hi), static_cast<uint16_t>(hi >> 16)}};
+    return builder.appendQuad(words);
+}
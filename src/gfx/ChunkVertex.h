@@ -0,0 +1,94 @@
+#ifndef CHUNKVERTEX_H
+#define CHUNKVERTEX_H
+
+#include "util/Face.h"
+#include "gfx/Mesh.h"
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+
+// Chunk meshes use a packed 8 byte vertex, read as two uvec4s by vert.glsl:
+//   0: x, y, z, normal
+//   1: u, v, texture layer, shade
+// Positions are block corners within the chunk and texture coordinates
+// are in blocks, so everything fits in unsigned bytes. Normals are the
+// six cube faces followed by the plant normals. Lighting is baked into
+// the shade (see chunkShade), which frag.glsl just multiplies the
+// texture by.
+enum class ChunkNormal : uint8_t {
+    RIGHT, LEFT, BACK, FRONT, TOP, BOTTOM,
+    PLANT_A, PLANT_A_BACK, PLANT_B, PLANT_B_BACK
+};
+
+inline ChunkNormal toChunkNormal(Face face) {
+    return static_cast<ChunkNormal>(face);
+}
+
+// The light on a vertex facing normal, from 0 to 255: the sun's, at a
+// fixed angle, darkened by the vertex's ambient occlusion, from 0 (open)
+// to 3 (in a corner), see GreedyMesher::getOcclusion. vert.glsl works
+// out the same for face records.
+uint8_t chunkShade(ChunkNormal normal, int occlusion = 0);
+
+MeshFormat chunkMeshFormat();
+
+MeshBuilder::Index makeChunkVert(MeshBuilder &builder,
+                                 const glm::ivec3 &pos,
+                                 ChunkNormal normal,
+                                 const glm::ivec3 &tex,
+                                 uint8_t shade);
+
+// A quad of four vertices facing normal, as MeshBuilder::appendQuad
+// makes them, with the corners' positions, texture coordinates and
+// shades given apart
+MeshBuilder::Index makeChunkQuad(MeshBuilder &builder,
+                                 const std::array<glm::ivec3, 4> &pos,
+                                 ChunkNormal normal,
+                                 const std::array<glm::ivec3, 4> &tex,
+                                 const std::array<uint8_t, 4> &shades);
+
+// How chunk meshes hold their cube faces: as four of the vertices above
+// each, or as one packed face record each (see makeChunkFace), which
+// vert.glsl expands into the quad's corners itself when FACE_RECORDS is
+// defined. Face records take a quarter of the memory, but need the
+// shader to fetch them from a buffer texture.
+enum class ChunkGeometry {
+    VERTICES,
+    FACES
+};
+
+// Face records are 8 bytes, read as a uvec2 by vert.glsl:
+//   x: bits 0-17 origin x, y, z, 18-20 face, 21-25 width - 1,
+//      26-30 height - 1, 31 flipped
+//   y: bits 0-7 texture layer, 8-15 occlusion, the rest unused
+// The origin is the face's lowest corner, and the quad extends width
+// blocks along the face's texture u axis and height blocks along its v
+// axis. Occlusion and flipped are as GreedyMesher::makeQuad takes and
+// works them out. Each record
+// is stored as four 16 bit "vertices" of chunkFaceFormat, so that a face
+// is still a quad to MeshBuilder, MeshArena and QuadIndexBuffer, and
+// gl_VertexID / 4 is the record's index in the vertex buffer.
+MeshFormat chunkFaceFormat();
+
+MeshBuilder::Index makeChunkFace(MeshBuilder &builder,
+                                 const glm::ivec3 &origin,
+                                 Face face,
+                                 int width, int height,
+                                 unsigned int layer,
+                                 uint8_t occlusion,
+                                 bool flipped);
+
+// Plants are drawn as instances of one shared mesh, each read as a uvec4
+// by vert.glsl when PLANT_INSTANCES is defined: the block's position
+// within the chunk, then its texture layer
+struct PlantInstance {
+    uint8_t x;
+    uint8_t y;
+    uint8_t z;
+    uint8_t layer;
+};
+
+MeshFormat plantInstanceFormat();
+
+#endif
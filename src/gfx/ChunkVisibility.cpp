@@ -0,0 +1,76 @@
+#include "gfx/ChunkVisibility.h"
+#include <vector>
+#include <utility>
+
+ChunkVisibility ChunkVisibility::compute(const ChunkFaceMasks::Mask &opaque) {
+    using Row = ChunkFaceMasks::Row;
+    const Row top_bit = ChunkFaceMasks::bit(Chunk::ZSize - 1);
+
+    // Opaque blocks start off filled, so only open blocks are flooded
+    ChunkFaceMasks::Mask filled = opaque;
+    uint64_t bits = 0;
+
+    // Rows still to flood into, along with bits that are open in them
+    std::vector<std::pair<int, Row>> pending;
+
+    for (unsigned int seed = 0; seed < ChunkFaceMasks::RowCount; seed++) {
+        // Each open block left in the row starts a new region
+        while (const Row seed_row = ~filled[seed]) {
+            // Flood fill the region, a row at a time
+            unsigned int faces = 0;
+            pending.emplace_back(seed, seed_row & -seed_row);
+            while (!pending.empty()) {
+                const int r = pending.back().first;
+                Row fill = pending.back().second & ~filled[r];
+                pending.pop_back();
+                if (!fill) {
+                    continue;
+                }
+
+                // Spread along z within the row
+                const Row open = ~filled[r];
+                for (;;) {
+                    const Row next = (fill | fill << 1 | fill >> 1) & open;
+                    if (next == fill) {
+                        break;
+                    }
+                    fill = next;
+                }
+                filled[r] |= fill;
+
+                const int rx = r / Chunk::YSize;
+                const int ry = r % Chunk::YSize;
+                auto touch = [&](Face face) { faces |= 1u << static_cast<int>(face); };
+                if (fill & ChunkFaceMasks::bit(0)) touch(Face::BOTTOM);
+                if (fill & top_bit) touch(Face::TOP);
+
+                // And on to the neighbouring rows
+                auto spread = [&](int nx, int ny, Face edge) {
+                    if (nx < 0 || nx >= Chunk::XSize || ny < 0 || ny >= Chunk::YSize) {
+                        touch(edge);
+                        return;
+                    }
+                    const int n = ChunkFaceMasks::rowIndex(nx, ny);
+                    if (fill & ~filled[n]) {
+                        pending.emplace_back(n, fill);
+                    }
+                };
+                spread(rx + 1, ry, Face::RIGHT);
+                spread(rx - 1, ry, Face::LEFT);
+                spread(rx, ry + 1, Face::BACK);
+                spread(rx, ry - 1, Face::FRONT);
+            }
+
+            for (Face a : all_faces) {
+                for (Face b : all_faces) {
+                    if ((faces & (1u << static_cast<int>(a))) &&
+                        (faces & (1u << static_cast<int>(b)))) {
+                        bits |= pairBit(a, b);
+                    }
+                }
+            }
+        }
+    }
+
+    return ChunkVisibility{bits};
+}
@@ -0,0 +1,40 @@
+#ifndef CHUNKVISIBILITY_H
+#define CHUNKVISIBILITY_H
+
+#include "gfx/ChunkFaceMasks.h"
+#include "util/Face.h"
+
+#include <cstdint>
+
+// Which of a chunk's faces can see each other through its non-opaque
+// blocks. A line of sight entering through one face can only leave
+// through the faces connected to it, so chunks walled off by solid
+// ground can be skipped without looking at their meshes.
+class ChunkVisibility {
+public:
+    // Every face sees every other, for chunks that haven't been computed
+    ChunkVisibility() : bits(AllBits) { }
+
+    // Flood fills the blocks not in opaque, connecting every pair of
+    // faces touched by the same open region
+    static ChunkVisibility compute(const ChunkFaceMasks::Mask &opaque);
+
+    bool canSee(Face from, Face to) const {
+        return (bits & pairBit(from, to)) != 0;
+    }
+
+    bool operator==(const ChunkVisibility &other) const { return bits == other.bits; }
+    bool operator!=(const ChunkVisibility &other) const { return bits != other.bits; }
+
+private:
+    static constexpr uint64_t AllBits = (uint64_t{1} << 36) - 1;
+    uint64_t bits;
+
+    explicit ChunkVisibility(uint64_t bits) : bits(bits) { }
+
+    static uint64_t pairBit(Face a, Face b) {
+        return uint64_t{1} << (6*static_cast<int>(a) + static_cast<int>(b));
+    }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "ChunkVisibility.h"
+#include <gtest/gtest.h>
+
+static void setBlock(ChunkFaceMasks::Mask &mask, int x, int y, int z) {
+    mask[ChunkFaceMasks::rowIndex(x, y)] |= ChunkFaceMasks::bit(z);
+}
+
+static void clearBlock(ChunkFaceMasks::Mask &mask, int x, int y, int z) {
+    mask[ChunkFaceMasks::rowIndex(x, y)] &= ~ChunkFaceMasks::bit(z);
+}
+
+TEST(ChunkVisibility, EmptyChunkSeesEverything) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(0);
+
+    auto vis = ChunkVisibility::compute(opaque);
+    for (Face a : all_faces) {
+        for (Face b : all_faces) {
+            EXPECT_TRUE(vis.canSee(a, b));
+        }
+    }
+    EXPECT_EQ(ChunkVisibility{}, vis);
+}
+
+TEST(ChunkVisibility, SolidChunkSeesNothing) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(~ChunkFaceMasks::Row{0});
+
+    auto vis = ChunkVisibility::compute(opaque);
+    for (Face a : all_faces) {
+        for (Face b : all_faces) {
+            EXPECT_FALSE(vis.canSee(a, b));
+        }
+    }
+}
+
+TEST(ChunkVisibility, TunnelConnectsItsEnds) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(~ChunkFaceMasks::Row{0});
+    // Along x, with a kink in y and z half way
+    for (int x = 0; x < 16; x++) {
+        clearBlock(opaque, x, 4, 4);
+    }
+    clearBlock(opaque, 15, 5, 4);
+    clearBlock(opaque, 15, 5, 5);
+    for (int x = 15; x < Chunk::XSize; x++) {
+        clearBlock(opaque, x, 5, 5);
+    }
+
+    auto vis = ChunkVisibility::compute(opaque);
+    EXPECT_TRUE(vis.canSee(Face::LEFT, Face::RIGHT));
+    EXPECT_TRUE(vis.canSee(Face::RIGHT, Face::LEFT));
+    EXPECT_FALSE(vis.canSee(Face::LEFT, Face::TOP));
+    EXPECT_FALSE(vis.canSee(Face::TOP, Face::BOTTOM));
+    EXPECT_FALSE(vis.canSee(Face::FRONT, Face::BACK));
+}
+
+TEST(ChunkVisibility, SeparateCavesDontConnect) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(0);
+    // A solid wall across z = 16, so the top and bottom halves are
+    // separate, and each touches the four sides
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            setBlock(opaque, x, y, 16);
+        }
+    }
+
+    auto vis = ChunkVisibility::compute(opaque);
+    EXPECT_FALSE(vis.canSee(Face::TOP, Face::BOTTOM));
+    EXPECT_TRUE(vis.canSee(Face::TOP, Face::LEFT));
+    EXPECT_TRUE(vis.canSee(Face::BOTTOM, Face::LEFT));
+    EXPECT_TRUE(vis.canSee(Face::LEFT, Face::RIGHT));
+}
@@ -1,18 +1,32 @@
 #include "DebugView.h"
 #include "gfx/tesselate.h"
+#include "gfx/QuadIndexBuffer.h"
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
 
 DebugView::DebugView(Font font,
-                     ShaderProgram prgm) :
+                     ShaderProgram prgm,
+                     const ThreadManager &tm,
+                     const World &world,
+                     const WorldView &worldview) :
     font(std::move(font)),
-    prgm(std::move(prgm))
+    prgm(std::move(prgm)),
+    tm(tm),
+    world(world),
+    worldview(worldview),
+    frame_times(120)
 { }
 
 void DebugView::render(Window &window) {
-    std::stringstream buf;
-    buf << "Hello World";
-    
-    tesselate(builder, font, buf.str());
+    auto now = Clock::now();
+    if (last_frame != Clock::time_point{}) {
+        std::chrono::duration<float, std::milli> dt = now - last_frame;
+        frame_times.add(dt.count());
+    }
+    last_frame = now;
+
+    tesselate(builder, font, buildText());
     Mesh fontmesh = builder.build();
 
     prgm.setUniform("perspective", getProjection(window).getMatrix());
@@ -25,8 +39,81 @@ void DebugView::render(Window &window) {
     glEnable(GL_DEPTH_TEST);
 }
 
+std::string DebugView::buildText() const {
+    static constexpr float MiB = 1024*1024;
+    const auto &meshstats = worldview.getChunkMeshes().getStats();
+
+    std::stringstream buf;
+    buf << std::fixed << std::setprecision(1);
+    buf << "frame ms p50 " << frame_times.getPercentile(.5)
+        << " p90 " << frame_times.getPercentile(.9)
+        << " p99 " << frame_times.getPercentile(.99)
+        << " max " << frame_times.getMax() << '\n';
+    buf << "chunks " << world.getChunks().getChunkCount()
+        << " pending " << world.getPendingChunkCount()
+        << " unlit " << world.getUnlitChunkCount()
+        << " light jobs " << world.getLightJobCount() << '\n';
+    buf << "meshes " << meshstats.meshes.get()
+        << " pending " << meshstats.pending.get()
+        << " vtx " << meshstats.vertex_bytes.get() / MiB << "MiB"
+        << " idx " << meshstats.index_bytes.get() / MiB << "MiB"
+        << " blocks left out " << meshstats.blocks_left_out.get() << '\n';
+    const long lookups = meshstats.hits.get() + meshstats.misses.get();
+    buf << "mesh cache " << meshstats.mesh_bytes.get() / MiB
+        << "/" << worldview.getChunkMeshes().getBudget().bytes / MiB << "MiB"
+        << " hit " << 100.0 * meshstats.hits.get() / std::max(lookups, 1l) << "%"
+        << " evicted " << meshstats.evictions.get()
+        << " shared " << meshstats.shared_meshes.get() << '\n';
+    const auto &arena = worldview.getChunkMeshes().getArena();
+    buf << "arena vtx " << arena.getUsedVertexBytes() / MiB
+        << "/" << arena.getVertexBytes() / MiB << "MiB"
+        << " idx " << arena.getUsedIndexBytes() / MiB
+        << "/" << arena.getIndexBytes() / MiB << "MiB"
+        << " quad idx " << QuadIndexBuffer::get().getBytes() / 1024 << "KiB"
+        << " staging " << arena.getUsedStagingBytes() / MiB
+        << "/" << arena.getStagingBytes() / MiB << "MiB" << '\n';
+    const auto &uploads = worldview.getChunkMeshes().getUploadTimes();
+    buf << "upload ms p50 " << uploads.getPercentile(.5)
+        << " p99 " << uploads.getPercentile(.99)
+        << " max " << uploads.getMax() << '\n';
+    const auto &plant_arena = worldview.getChunkMeshes().getPlantArena();
+    buf << "plants " << meshstats.plants.get()
+        << " " << plant_arena.getUsedBytes() / 1024
+        << "/" << plant_arena.getBytes() / 1024 << "KiB" << '\n';
+    const auto &viewstats = worldview.getStats();
+    buf << "draws " << viewstats.draw_calls.get()
+        << " tris " << viewstats.triangles.get() << '\n';
+    buf << "view chunks drawn " << viewstats.chunks_drawn.get()
+        << " culled " << viewstats.chunks_culled.get()
+        << " occluded " << viewstats.chunks_occluded.get()
+        << " hidden " << viewstats.chunks_hidden.get() << '\n';
+    const auto &occlusion = worldview.getOcclusionTimes();
+    buf << "occlusion ms p50 " << occlusion.getPercentile(.5)
+        << " max " << occlusion.getMax()
+        << " occluders " << viewstats.occluders.get() << '\n';
+    const auto &remesh = worldview.getChunkMeshes().getRemeshLatency();
+    buf << "remesh ms p50 " << remesh.getPercentile(.5)
+        << " p95 " << remesh.getPercentile(.95)
+        << " sections built " << meshstats.sections_built.get()
+        << " shared " << meshstats.sections_shared.get()
+        << " replanted " << meshstats.sections_replanted.get()
+        << " skipped " << meshstats.sections_skipped.get() << '\n';
+    buf << "workers";
+    for (unsigned int i = 0; i < tm.getWorkerCount(); i++) {
+        buf << ' ' << tm.getWorkerQueueDepth(i);
+    }
+    buf << " main " << tm.getMainQueueDepth();
+
+    return buf.str();
+}
+
 OrthoProjection DebugView::getProjection(Window &window) {
-    return OrthoProjection{
+    // Text is laid out downwards from the first line's baseline at y=0,
+    // so shift things so the first line sits at the top of the window
+    OrthoProjection proj{
         static_cast<float>(window.getWidth()),
         static_cast<float>(window.getHeight())};
+    proj.top = font.getLineHeight();
+    proj.bottom = proj.top - window.getHeight();
+    return proj;
 }
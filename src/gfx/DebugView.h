@@ -1,15 +1,25 @@
 #ifndef DEBUGVIEW_H
 #define DEBUGVIEW_H
 
+#include "util/ThreadManager.h"
+#include "util/SampleWindow.h"
 #include "gfx/View.h"
 #include "gfx/Font.h"
 #include "gfx/Shader.h"
 #include "gfx/Camera.h"
+#include "gfx/WorldView.h"
+#include "World.h"
+
+#include <chrono>
+#include <string>
 
 class DebugView : public View {
 public:
     DebugView(Font font,
-              ShaderProgram prgm);
+              ShaderProgram prgm,
+              const ThreadManager &tm,
+              const World &world,
+              const WorldView &worldview);
 
     virtual void render(Window &window);
     
@@ -18,8 +28,17 @@ private:
     Sampler sampler;
     ShaderProgram prgm;
 
+    const ThreadManager &tm;
+    const World &world;
+    const WorldView &worldview;
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point last_frame;
+    SampleWindow frame_times;
+
     MeshBuilder builder;
-    
+
+    std::string buildText() const;
     OrthoProjection getProjection(Window &window);
 };
 
@@ -0,0 +1,27 @@
+#include "gfx/Frustum.h"
+
+Frustum::Frustum(const glm::mat4 &projview) {
+    // Each plane is the sum or difference of the w row with the x, y or z
+    // row, from -w <= x, y, z <= w in clip space
+    auto row = [&](int i) {
+        return glm::vec4{projview[0][i], projview[1][i], projview[2][i], projview[3][i]};
+    };
+
+    for (int axis = 0; axis < 3; axis++) {
+        planes[2*axis] = row(3) + row(axis);
+        planes[2*axis + 1] = row(3) - row(axis);
+    }
+}
+
+bool Frustum::intersects(const glm::vec3 &min, const glm::vec3 &max) const {
+    for (const glm::vec4 &plane : planes) {
+        // The corner furthest along the plane's normal
+        const glm::vec3 corner{plane.x > 0 ? max.x : min.x,
+                               plane.y > 0 ? max.y : min.y,
+                               plane.z > 0 ? max.z : min.z};
+        if (plane.x*corner.x + plane.y*corner.y + plane.z*corner.z + plane.w < 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <array>
+
+// The planes bounding what a projection * view matrix can see, for
+// culling whole boxes of geometry before drawing them
+class Frustum {
+public:
+    explicit Frustum(const glm::mat4 &projview);
+
+    // Conservative, so boxes near the corners may pass while outside
+    bool intersects(const glm::vec3 &min, const glm::vec3 &max) const;
+
+private:
+    // Inside is dot(plane.xyz, pos) + plane.w >= 0
+    std::array<glm::vec4, 6> planes;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#include "Frustum.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <gtest/gtest.h>
+
+// Looking down -z from the origin, like an untransformed GL camera
+static Frustum makeFrustum() {
+    return Frustum{glm::perspective(45.0f, 1.0f, 1.0f, 100.0f)};
+}
+
+TEST(Frustum, BoxInFrontIsVisible) {
+    EXPECT_TRUE(makeFrustum().intersects(glm::vec3{-1, -1, -11}, glm::vec3{1, 1, -9}));
+}
+
+TEST(Frustum, BoxBehindIsCulled) {
+    EXPECT_FALSE(makeFrustum().intersects(glm::vec3{-1, -1, 9}, glm::vec3{1, 1, 11}));
+}
+
+TEST(Frustum, BoxOffToTheSideIsCulled) {
+    EXPECT_FALSE(makeFrustum().intersects(glm::vec3{20, -1, -11}, glm::vec3{22, 1, -9}));
+    EXPECT_FALSE(makeFrustum().intersects(glm::vec3{-1, -22, -11}, glm::vec3{1, -20, -9}));
+}
+
+TEST(Frustum, BoxBeyondFarIsCulled) {
+    EXPECT_FALSE(makeFrustum().intersects(glm::vec3{-1, -1, -300}, glm::vec3{1, 1, -200}));
+}
+
+TEST(Frustum, BoxStraddlingEdgeIsVisible) {
+    EXPECT_TRUE(makeFrustum().intersects(glm::vec3{0, -1, -11}, glm::vec3{30, 1, -9}));
+}
+
+TEST(Frustum, BoxAroundEyeIsVisible) {
+    EXPECT_TRUE(makeFrustum().intersects(glm::vec3{-5, -5, -5}, glm::vec3{5, 5, 5}));
+}
@@ -0,0 +1,178 @@
+#include "GreedyMesher.h"
+#include "gfx/ChunkVertex.h"
+
+static_assert(Chunk::XSize == Chunk::YSize &&
+              Chunk::YSize == Chunk::ZSize,
+              "GreedyMesher needs cubic chunks");
+
+namespace {
+    // How each face's texture is laid out over the block. The texture's
+    // u and v run along the given chunk axes, possibly reversed.
+    struct FaceAxes {
+        int n;
+        int u;
+        int v;
+        bool uflip;
+        bool vflip;
+        bool positive;
+    };
+
+    const FaceAxes face_axes[] = {
+        { 0, 1, 2, false, false, true },  // RIGHT
+        { 0, 1, 2, true, false, false },  // LEFT
+        { 1, 0, 2, true, false, true },   // BACK
+        { 1, 0, 2, false, false, false }, // FRONT
+        { 2, 0, 1, false, false, true },  // TOP
+        { 2, 0, 1, false, true, false },  // BOTTOM
+    };
+
+    const FaceAxes &getAxes(Face face) {
+        return face_axes[static_cast<int>(face)];
+    }
+}
+
+ChunkIndex GreedyMesher::slicePos(Face face, int depth, int u, int v) {
+    const FaceAxes &axes = getAxes(face);
+    glm::ivec3 pos;
+    pos[axes.n] = depth;
+    pos[axes.u] = u;
+    pos[axes.v] = v;
+    return {pos};
+}
+
+glm::ivec3 GreedyMesher::sliceCoords(Face face, const glm::ivec3 &pos) {
+    const FaceAxes &axes = getAxes(face);
+    return {pos[axes.n], pos[axes.u], pos[axes.v]};
+}
+
+bool GreedyMesher::canMerge(uint32_t value) {
+    const uint8_t occlusion = value >> 16;
+    return occlusion == 0x00 || occlusion == 0x55 ||
+           occlusion == 0xaa || occlusion == 0xff;
+}
+
+void GreedyMesher::meshSlice(MeshBuilder &builder,
+                             Face face,
+                             int depth,
+                             Slice &slice,
+                             ChunkGeometry geometry) {
+    for (int v = 0; v < Size; v++) {
+        for (int u = 0; u < Size; ) {
+            const uint32_t value = slice[sliceOffset(u, v)];
+            if (!value) {
+                u++;
+                continue;
+            }
+
+            // Faces shaded unevenly are left on their own
+            const int maxw = canMerge(value) ? Size - u : 1;
+            const int maxh = canMerge(value) ? Size - v : 1;
+
+            int w = 1;
+            while (w < maxw && slice[sliceOffset(u + w, v)] == value) {
+                w++;
+            }
+
+            int h = 1;
+            for (; h < maxh; h++) {
+                bool rowmatches = true;
+                for (int i = 0; i < w; i++) {
+                    if (slice[sliceOffset(u + i, v + h)] != value) {
+                        rowmatches = false;
+                        break;
+                    }
+                }
+
+                if (!rowmatches) {
+                    break;
+                }
+            }
+
+            for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                    slice[sliceOffset(u + i, v + j)] = 0;
+                }
+            }
+
+            makeQuad(builder, face, depth, u, v, w, h, value, geometry);
+            u += w;
+        }
+    }
+}
+
+void GreedyMesher::meshFace(MeshBuilder &builder,
+                            Face face,
+                            const glm::ivec3 &pos,
+                            unsigned int layer,
+                            uint8_t occlusion,
+                            ChunkGeometry geometry) {
+    const glm::ivec3 coords = sliceCoords(face, pos);
+    makeQuad(builder, face, coords.x, coords.y, coords.z, 1, 1,
+             faceValue(layer, occlusion), geometry);
+}
+
+void GreedyMesher::makeQuad(MeshBuilder &builder,
+                            Face face,
+                            int depth,
+                            int u, int v,
+                            int w, int h,
+                            uint32_t value,
+                            ChunkGeometry geometry) {
+    const FaceAxes &axes = getAxes(face);
+    const ChunkNormal normal = toChunkNormal(face);
+    const unsigned int texnum = (value & 0xffff) - 1;
+    const uint8_t occlusion = value >> 16;
+
+    // Quads are split along the diagonal from corner (1, 0) to (0, 1),
+    // unless those two are more occluded than the other two, so that a
+    // dark corner's shading doesn't run along the split
+    int corner_occlusion[4];
+    for (int corner = 0; corner < 4; corner++) {
+        corner_occlusion[corner] = (occlusion >> 2*corner) & 3;
+    }
+    const bool flipped = corner_occlusion[1] + corner_occlusion[2] >
+                         corner_occlusion[0] + corner_occlusion[3];
+
+    glm::ivec3 origin;
+    origin[axes.n] = axes.positive ? depth + 1 : depth;
+    origin[axes.u] = u;
+    origin[axes.v] = v;
+
+    // vert.glsl works out the rest from the face, with the same axes
+    if (geometry == ChunkGeometry::FACES) {
+        makeChunkFace(builder, origin, face, w, h, texnum, occlusion, flipped);
+        return;
+    }
+
+    glm::ivec3 du, dv;
+    du[axes.u] = w;
+    dv[axes.v] = h;
+
+    const int tu0 = axes.uflip ? w : 0;
+    const int tu1 = axes.uflip ? 0 : w;
+    const int tv0 = axes.vflip ? h : 0;
+    const int tv1 = axes.vflip ? 0 : h;
+    const int layer = texnum;
+
+    // By corner, as for occlusion
+    const glm::ivec3 pos[] = {origin, origin + du, origin + dv, origin + du + dv};
+    const glm::ivec3 tex[] = {{tu0, tv0, layer}, {tu1, tv0, layer},
+                              {tu0, tv1, layer}, {tu1, tv1, layer}};
+
+    // Keep the winding counter-clockwise when seen from outside the block
+    const bool ccw = (glm::cross(du, dv)[axes.n] > 0) == axes.positive;
+    static const int orders[2][2][4] = {
+        {{0, 2, 1, 3}, {2, 3, 0, 1}},
+        {{0, 1, 2, 3}, {1, 3, 0, 2}}};
+    const int *order = orders[ccw][flipped];
+
+    std::array<glm::ivec3, 4> quad_pos, quad_tex;
+    std::array<uint8_t, 4> quad_shades;
+    for (int i = 0; i < 4; i++) {
+        const int corner = order[i];
+        quad_pos[i] = pos[corner];
+        quad_tex[i] = tex[corner];
+        quad_shades[i] = chunkShade(normal, corner_occlusion[corner]);
+    }
+    makeChunkQuad(builder, quad_pos, normal, quad_tex, quad_shades);
+}
@@ -0,0 +1,96 @@
+#ifndef GREEDYMESHER_H
+#define GREEDYMESHER_H
+
+#include "util/Face.h"
+#include "gfx/Mesh.h"
+#include "gfx/ChunkVertex.h"
+#include "Chunk.h"
+
+#include <array>
+#include <cstdint>
+
+// Merges coplanar, adjacent cube faces which share a texture layer into
+// larger quads. Faces are fed in one chunk slice at a time, the merged
+// quads tile their texture, so the sampler must use repeat wrapping.
+// Faces are only merged when their corners' ambient occlusion is all the
+// same, so that the shading across a quad doesn't stretch.
+class GreedyMesher {
+public:
+    static constexpr int Size = Chunk::XSize;
+
+    // One layer of faces perpendicular to a face normal, indexed by the
+    // face's (u, v) texture axes. Holds faceValue, or 0 for no face.
+    using Slice = std::array<uint32_t, Size*Size>;
+
+    // Occlusion is as getOcclusion gives it, with none by default
+    static uint32_t faceValue(unsigned int layer, uint8_t occlusion = 0) {
+        return (layer + 1) | uint32_t{occlusion} << 16;
+    }
+
+    static unsigned int sliceOffset(int u, int v) { return u + Size*v; }
+
+    // Chunk position of the block owning the face at (u, v) in the
+    // slice at the given depth along face's normal axis. Positions
+    // outside the chunk are fine, for its surroundings.
+    static ChunkIndex slicePos(Face face, int depth, int u, int v);
+
+    // Inverse of slicePos, returns (depth, u, v)
+    static glm::ivec3 sliceCoords(Face face, const glm::ivec3 &pos);
+
+    // The ambient occlusion of the corners of the face of the block at
+    // pos, given whether a block position is opaque(pos). Each corner
+    // goes from 0, open, to 3, between two opaque blocks, by how many of
+    // the three blocks touching it in front of the face are opaque. Two
+    // bits per corner, for (u, v) corners (0, 0), (1, 0), (0, 1) and (1,
+    // 1) from bit 0 up.
+    template <typename Opaque>
+    static uint8_t getOcclusion(Face face, const glm::ivec3 &pos, Opaque opaque);
+
+    // Merges the faces in slice and appends the resulting quads to
+    // builder, as chunk vertices or face records per geometry. Clears
+    // slice as a side effect.
+    static void meshSlice(MeshBuilder &builder,
+                          Face face,
+                          int depth,
+                          Slice &slice,
+                          ChunkGeometry geometry = ChunkGeometry::VERTICES);
+
+    // Appends just the one face, of the block at pos, as meshSlice would
+    static void meshFace(MeshBuilder &builder,
+                         Face face,
+                         const glm::ivec3 &pos,
+                         unsigned int layer,
+                         uint8_t occlusion,
+                         ChunkGeometry geometry = ChunkGeometry::VERTICES);
+
+private:
+    static bool canMerge(uint32_t value);
+    static void makeQuad(MeshBuilder &builder,
+                         Face face,
+                         int depth,
+                         int u, int v,
+                         int w, int h,
+                         uint32_t value,
+                         ChunkGeometry geometry);
+};
+
+template <typename Opaque>
+uint8_t GreedyMesher::getOcclusion(Face face, const glm::ivec3 &pos, Opaque opaque) {
+    const glm::ivec3 front = sliceCoords(face, pos + faceNormal(face));
+    auto at = [&](int du, int dv) -> int {
+        return opaque(slicePos(face, front.x, front.y + du, front.z + dv).getVec());
+    };
+
+    uint8_t occlusion = 0;
+    for (int corner = 0; corner < 4; corner++) {
+        const int du = corner & 1 ? 1 : -1;
+        const int dv = corner & 2 ? 1 : -1;
+        const int side_u = at(du, 0);
+        const int side_v = at(0, dv);
+        const int level = side_u && side_v ? 3 : side_u + side_v + at(du, dv);
+        occlusion |= level << 2*corner;
+    }
+    return occlusion;
+}
+
+#endif
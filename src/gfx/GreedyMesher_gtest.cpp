@@ -0,0 +1,160 @@
+#include "GreedyMesher.h"
+#include "ChunkVertex.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+static unsigned int quadCount(const MeshBuilder &builder) {
+    return builder.getIndexCount() / 6;
+}
+
+TEST(GreedyMesher, FullSliceIsOneQuad) {
+    GreedyMesher::Slice slice;
+    slice.fill(3);
+
+    MeshBuilder builder{chunkMeshFormat()};
+    GreedyMesher::meshSlice(builder, Face::TOP, 0, slice);
+    EXPECT_EQ(1u, quadCount(builder));
+
+    for (auto tex : slice) {
+        EXPECT_EQ(0u, tex);
+    }
+}
+
+TEST(GreedyMesher, DifferentTexturesDontMerge) {
+    GreedyMesher::Slice slice;
+    for (int v = 0; v < GreedyMesher::Size; v++) {
+        for (int u = 0; u < GreedyMesher::Size; u++) {
+            slice[GreedyMesher::sliceOffset(u, v)] = 1 + (u + v) % 2;
+        }
+    }
+
+    MeshBuilder builder{chunkMeshFormat()};
+    GreedyMesher::meshSlice(builder, Face::LEFT, 5, slice);
+    EXPECT_EQ(unsigned(GreedyMesher::Size*GreedyMesher::Size), quadCount(builder));
+}
+
+TEST(GreedyMesher, Rectangles) {
+    GreedyMesher::Slice slice;
+    slice.fill(0);
+    // An L shape, which merges into two quads
+    for (int u = 0; u < 4; u++) {
+        slice[GreedyMesher::sliceOffset(u, 0)] = 1;
+    }
+    for (int v = 1; v < 3; v++) {
+        slice[GreedyMesher::sliceOffset(0, v)] = 1;
+    }
+
+    MeshBuilder builder{chunkMeshFormat()};
+    GreedyMesher::meshSlice(builder, Face::FRONT, 0, slice);
+    EXPECT_EQ(2u, quadCount(builder));
+}
+
+TEST(GreedyMesher, SlicePos) {
+    EXPECT_EQ(glm::ivec3(7, 1, 2), GreedyMesher::slicePos(Face::RIGHT, 7, 1, 2).getVec());
+    EXPECT_EQ(glm::ivec3(1, 7, 2), GreedyMesher::slicePos(Face::FRONT, 7, 1, 2).getVec());
+    EXPECT_EQ(glm::ivec3(1, 2, 7), GreedyMesher::slicePos(Face::BOTTOM, 7, 1, 2).getVec());
+
+    for (auto face : all_faces) {
+        auto pos = GreedyMesher::slicePos(face, 3, 4, 5).getVec();
+        EXPECT_EQ(glm::ivec3(3, 4, 5), GreedyMesher::sliceCoords(face, pos));
+    }
+}
+
+// Expands a face record's corners as vert.glsl does with FACE_RECORDS,
+// into the x, y, z, normal, u, v, layer, 0 of chunk vertices
+static std::array<uint8_t, 8> expandFace(const uint16_t *words, int corner) {
+    static const int face_axes[6][2] = {{1, 2}, {1, 2}, {0, 2}, {0, 2}, {0, 1}, {0, 1}};
+    static const bool face_flips[6][2] = {{false, false}, {true, false}, {true, false},
+                                          {false, false}, {false, false}, {false, true}};
+    static const bool face_ccw[6] = {true, false, false, true, true, false};
+
+    const uint32_t lo = words[0] | uint32_t{words[1]} << 16;
+    const uint32_t hi = words[2] | uint32_t{words[3]} << 16;
+    const int face = (lo >> 18) & 7;
+    const int size[2] = {int((lo >> 21) & 31) + 1, int((lo >> 26) & 31) + 1};
+    if (lo >> 31) {
+        corner = (((corner & 1) << 1) | (corner >> 1)) ^ 1;
+    }
+    const int side[2] = {face_ccw[face] ? corner & 1 : corner >> 1,
+                         face_ccw[face] ? corner >> 1 : corner & 1};
+
+    int pos[3] = {int(lo & 63), int((lo >> 6) & 63), int((lo >> 12) & 63)};
+    int tex[2];
+    for (int i = 0; i < 2; i++) {
+        const int extent = side[i]*size[i];
+        pos[face_axes[face][i]] += extent;
+        tex[i] = face_flips[face][i] ? size[i] - extent : extent;
+    }
+    const int occlusion = (hi >> (8 + 2*(side[0] + 2*side[1]))) & 3;
+    return {{uint8_t(pos[0]), uint8_t(pos[1]), uint8_t(pos[2]), uint8_t(face),
+             uint8_t(tex[0]), uint8_t(tex[1]), uint8_t(hi & 255),
+             chunkShade(ChunkNormal(face), occlusion)}};
+}
+
+TEST(GreedyMesher, FaceRecordsExpandToVertices) {
+    for (auto face : all_faces) {
+        GreedyMesher::Slice vert_slice;
+        vert_slice.fill(0);
+        for (int u = 3; u < 7; u++) {
+            vert_slice[GreedyMesher::sliceOffset(u, 2)] = GreedyMesher::faceValue(4);
+        }
+        for (int v = 3; v < 6; v++) {
+            vert_slice[GreedyMesher::sliceOffset(3, v)] = GreedyMesher::faceValue(4, 0x55);
+        }
+        // Unevenly occluded, one flipped and one not
+        vert_slice[GreedyMesher::sliceOffset(31, 31)] = GreedyMesher::faceValue(1, 0x14);
+        vert_slice[GreedyMesher::sliceOffset(20, 20)] = GreedyMesher::faceValue(1, 0x0b);
+        GreedyMesher::Slice face_slice = vert_slice;
+
+        MeshBuilder verts{chunkMeshFormat()};
+        GreedyMesher::meshSlice(verts, face, 9, vert_slice);
+        MeshBuilder faces{chunkFaceFormat()};
+        GreedyMesher::meshSlice(faces, face, 9, face_slice, ChunkGeometry::FACES);
+
+        ASSERT_EQ(4u, quadCount(faces));
+        ASSERT_EQ(quadCount(verts), quadCount(faces));
+        EXPECT_TRUE(faces.isQuads());
+        EXPECT_EQ(8*quadCount(faces), faces.getBuffer().size());
+
+        const auto *records = reinterpret_cast<const uint16_t *>(&faces.getBuffer().front());
+        const uint8_t *vertices = &verts.getBuffer().front();
+        for (unsigned int quad = 0; quad < quadCount(faces); quad++) {
+            for (int corner = 0; corner < 4; corner++) {
+                const auto expanded = expandFace(records + 4*quad, corner);
+                const uint8_t *vertex = vertices + 8*(4*quad + corner);
+                EXPECT_TRUE(std::equal(expanded.begin(), expanded.end(), vertex))
+                    << "face " << int(face) << " quad " << quad << " corner " << corner;
+            }
+        }
+    }
+}
+
+TEST(GreedyMesher, UnevenOcclusionDoesntMerge) {
+    GreedyMesher::Slice slice;
+    slice.fill(0);
+    for (int u = 0; u < 4; u++) {
+        slice[GreedyMesher::sliceOffset(u, 0)] = GreedyMesher::faceValue(2, 0xff);
+        slice[GreedyMesher::sliceOffset(u, 1)] = GreedyMesher::faceValue(2, 0x01);
+    }
+
+    MeshBuilder builder{chunkMeshFormat()};
+    GreedyMesher::meshSlice(builder, Face::TOP, 0, slice);
+    EXPECT_EQ(5u, quadCount(builder));
+}
+
+TEST(GreedyMesher, Occlusion) {
+    // A wall along y = 1 beside the top face of the block at the origin
+    auto wall = [](const glm::ivec3 &pos) { return pos.y == 1 && pos.z == 1; };
+    // Corners (0, 1) and (1, 1) along x and y are next to it
+    EXPECT_EQ(0xa0, GreedyMesher::getOcclusion(Face::TOP, glm::ivec3{0, 0, 0}, wall));
+
+    // In an inside corner, the corner between both walls is fully
+    // occluded, those along one wall only partly
+    auto corner = [](const glm::ivec3 &pos) {
+        return pos.z == 1 && (pos.x == 1 || pos.y == 1);
+    };
+    EXPECT_EQ(0xe8, GreedyMesher::getOcclusion(Face::TOP, glm::ivec3{0, 0, 0}, corner));
+
+    auto open = [](const glm::ivec3 &) { return false; };
+    EXPECT_EQ(0, GreedyMesher::getOcclusion(Face::LEFT, glm::ivec3{4, 4, 4}, open));
+}
@@ -0,0 +1,131 @@
+#include "gfx/InstanceArena.h"
+#include "gfx/QuadIndexBuffer.h"
+#include <GL/glew.h>
+#include <algorithm>
+
+ArenaInstances &ArenaInstances::operator=(ArenaInstances &&other) {
+    release();
+    arena = other.arena;
+    first = other.first;
+    count = other.count;
+    other.arena = nullptr;
+    return *this;
+}
+
+size_t ArenaInstances::getBytes() const {
+    return arena ? count * arena->getInstanceFormat().getVertexSize() : 0;
+}
+
+void ArenaInstances::release() {
+    if (arena) {
+        arena->free(*this);
+        arena = nullptr;
+    }
+}
+
+InstanceArena::InstanceArena(const MeshBuilder &mesh, MeshFormat instance_format_,
+                             size_t initial_instances) :
+    mesh_format(mesh.getFormat()),
+    instance_format(std::move(instance_format_)),
+    index_count(mesh.getIndexCount()),
+    quads(mesh.isQuads()),
+    vao(VertexArrayObject::generate()),
+    vbuf(mesh.getBuffer()),
+    instances(initial_instances)
+{
+    instbuf.setData(nullptr, initial_instances * instance_format.getVertexSize());
+    if (quads) {
+        QuadIndexBuffer::get().reserve(index_count / 6);
+    } else {
+        ibuf.setData(&mesh.getIndexBuffer().front(),
+                     index_count * sizeof(MeshBuilder::Index), Buffer::ELEMENTS);
+    }
+
+    glBindVertexArray(vao.getID());
+    glBindBuffer(GL_ARRAY_BUFFER, vbuf.getID());
+    mesh_format.setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 quads ? QuadIndexBuffer::get().getBuffer().getID() : ibuf.getID());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+ArenaInstances InstanceArena::allocate(const void *data, size_t count) {
+    ArenaInstances run;
+    if (count == 0) {
+        return run;
+    }
+
+    const size_t size = instance_format.getVertexSize();
+    auto first = instances.allocate(count);
+    if (!first) {
+        // Out of room, so double the buffer (or more) and copy everything
+        // over. Draws point the instance attributes at the new buffer.
+        const size_t newsize = std::max(2*instances.getSize(), instances.getSize() + count);
+        Buffer newbuf;
+        newbuf.setData(nullptr, newsize * size);
+        glBindBuffer(GL_COPY_READ_BUFFER, instbuf.getID());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newbuf.getID());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            0, 0, instances.getSize() * size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        instbuf = std::move(newbuf);
+        instances.grow(newsize);
+        first = instances.allocate(count);
+    }
+
+    run.first = *first;
+    run.count = count;
+    run.arena = this;
+    instbuf.setSubData(run.first * size, data, count * size, Buffer::ARRAY);
+    return run;
+}
+
+void InstanceArena::addDraw(const ArenaInstances &run, const glm::vec3 &offset) {
+    if (!run) {
+        return;
+    }
+    draws.push_back(Draw{run.first, run.count, offset});
+}
+
+void InstanceArena::draw(const ShaderProgram &prgm) {
+    last_draw_count = draws.size();
+    last_instance_count = 0;
+    if (draws.empty()) {
+        return;
+    }
+
+    // A draw per run of instances, with the offset as a constant
+    // attribute, and the instance attributes pointed at the run
+    glUseProgram(prgm.getID());
+    glBindVertexArray(vao.getID());
+    glBindBuffer(GL_ARRAY_BUFFER, instbuf.getID());
+    const unsigned int offset_attrib = getOffsetAttribute();
+    const size_t size = instance_format.getVertexSize();
+    const GLenum type = quads ? QuadIndexBuffer::get().getType() : GL_UNSIGNED_INT;
+    for (const Draw &draw : draws) {
+        glVertexAttrib3f(offset_attrib, draw.offset.x, draw.offset.y, draw.offset.z);
+        instance_format.setupAttributes(getInstanceAttribute(), draw.first * size, 1);
+        glDrawElementsInstanced(GL_TRIANGLES, index_count, type,
+                                nullptr, draw.count);
+        last_instance_count += draw.count;
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    draws.clear();
+}
+
+size_t InstanceArena::getBytes() const {
+    return instances.getSize() * instance_format.getVertexSize();
+}
+
+size_t InstanceArena::getUsedBytes() const {
+    return instances.getUsed() * instance_format.getVertexSize();
+}
+
+void InstanceArena::free(const ArenaInstances &run) {
+    instances.free(run.first, run.count);
+}
@@ -0,0 +1,102 @@
+#ifndef INSTANCEARENA_H
+#define INSTANCEARENA_H
+
+#include "gfx/Mesh.h"
+#include "util/RangeAllocator.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class InstanceArena;
+
+// A run of instances stored in an InstanceArena's buffer. Like
+// ArenaMesh, the range is freed when it is destroyed.
+class ArenaInstances {
+public:
+    ArenaInstances() { }
+    ArenaInstances(const ArenaInstances &) = delete;
+    ArenaInstances(ArenaInstances &&other) { *this = std::move(other); }
+    ~ArenaInstances() { release(); }
+
+    ArenaInstances &operator=(const ArenaInstances &) = delete;
+    ArenaInstances &operator=(ArenaInstances &&other);
+
+    explicit operator bool() const { return arena != nullptr; }
+
+    size_t getCount() const { return count; }
+    size_t getBytes() const;
+
+private:
+    friend class InstanceArena;
+
+    InstanceArena *arena = nullptr;
+    size_t first = 0;
+    size_t count = 0;
+
+    void release();
+};
+
+// One mesh drawn many times over, with each copy's attributes coming out
+// of a buffer shared by all the runs of instances. The mesh's attributes
+// come first, then the per draw offset (as in MeshArena), then the
+// instance format's.
+class InstanceArena {
+public:
+    InstanceArena(const MeshBuilder &mesh, MeshFormat instance_format,
+                  size_t initial_instances);
+    InstanceArena(const InstanceArena &) = delete;
+    InstanceArena &operator=(const InstanceArena &) = delete;
+
+    const MeshFormat &getInstanceFormat() const { return instance_format; }
+    unsigned int getOffsetAttribute() const { return mesh_format.getAttributeCount(); }
+    unsigned int getInstanceAttribute() const { return getOffsetAttribute() + 1; }
+
+    // Copies count instances of the instance format into the arena,
+    // growing it if need be. No instances give empty runs.
+    ArenaInstances allocate(const void *data, size_t count);
+    template <typename T>
+    ArenaInstances allocate(const std::vector<T> &instances) {
+        return allocate(instances.data(), instances.size());
+    }
+
+    // Queues a copy of the mesh for each of the instances, translated by
+    // offset, to be drawn by the next draw()
+    void addDraw(const ArenaInstances &instances, const glm::vec3 &offset);
+    void draw(const ShaderProgram &prgm);
+
+    size_t getBytes() const;
+    size_t getUsedBytes() const;
+    unsigned int getLastDrawCount() const { return last_draw_count; }
+    size_t getLastInstanceCount() const { return last_instance_count; }
+    size_t getMeshIndexCount() const { return index_count; }
+
+private:
+    friend class ArenaInstances;
+
+    struct Draw {
+        size_t first;
+        size_t count;
+        glm::vec3 offset;
+    };
+
+    MeshFormat mesh_format;
+    MeshFormat instance_format;
+    size_t index_count;
+    // Quad meshes draw with QuadIndexBuffer, leaving ibuf empty
+    bool quads;
+
+    VertexArrayObject vao;
+    Buffer vbuf;
+    Buffer ibuf;
+    Buffer instbuf;
+    RangeAllocator instances;
+
+    std::vector<Draw> draws;
+    unsigned int last_draw_count = 0;
+    size_t last_instance_count = 0;
+
+    void free(const ArenaInstances &instances);
+};
+
+#endif
@@ -1,77 +1,192 @@
 #include "gfx/Mesh.h"
+#include "gfx/QuadIndexBuffer.h"
 #include <algorithm>
 #include <cassert>
 #include <GL/glew.h>
 
-MeshFormat::MeshFormat(const std::initializer_list<unsigned int> &attr_lengths) :
-    attr_lengths(attr_lengths),
-    vert_size(std::accumulate(begin(attr_lengths), end(attr_lengths), 0)) { }
+MeshFormat::MeshFormat(const std::initializer_list<unsigned int> &attr_lengths) {
+    for (unsigned int length : attr_lengths) {
+        attrs.push_back({length, Type::FLOAT, Mode::FLOAT});
+    }
+    computeLayout();
+}
+
+MeshFormat::MeshFormat(const std::initializer_list<Attribute> &attrs) :
+    attrs(attrs)
+{
+    computeLayout();
+}
+
+unsigned int MeshFormat::getTypeSize(Type type) {
+    switch (type) {
+    case Type::BYTE:
+    case Type::UNSIGNED_BYTE:
+        return 1;
+    case Type::SHORT:
+    case Type::UNSIGNED_SHORT:
+        return 2;
+    case Type::FLOAT:
+    case Type::INT:
+    case Type::UNSIGNED_INT:
+    default:
+        return 4;
+    }
+}
+
+void MeshFormat::computeLayout() {
+    offsets.clear();
+    vert_size = 0;
+    for (const Attribute &attr : attrs) {
+        assert(attr.type != Type::FLOAT || attr.mode == Mode::FLOAT);
+        offsets.push_back(vert_size);
+        vert_size += attr.length * getTypeSize(attr.type);
+    }
+}
+
+static GLenum toGLType(MeshFormat::Type type) {
+    static const GLenum gl_types[] = {
+        GL_FLOAT,
+        GL_BYTE,
+        GL_UNSIGNED_BYTE,
+        GL_SHORT,
+        GL_UNSIGNED_SHORT,
+        GL_INT,
+        GL_UNSIGNED_INT
+    };
+
+    return gl_types[static_cast<int>(type)];
+}
+
+void MeshFormat::setupAttributes(unsigned int first, size_t base_offset,
+                                 unsigned int divisor) const {
+    for (unsigned int i=0; i < getAttributeCount(); i++) {
+        const Attribute &attr = getAttribute(i);
+        const GLenum type = toGLType(attr.type);
+        const unsigned int attrib = first + i;
+        void *offset = reinterpret_cast<void *>(base_offset + getAttributeOffset(i));
+
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, divisor);
+        if (attr.mode == Mode::INTEGER) {
+            glVertexAttribIPointer(attrib, attr.length, type, vert_size, offset);
+        } else {
+            const GLboolean normalized =
+                attr.mode == Mode::NORMALIZED ? GL_TRUE : GL_FALSE;
+            glVertexAttribPointer(attrib, attr.length, type, normalized, vert_size, offset);
+        }
+    }
+}
 
 MeshBuilder::MeshBuilder() :
     vert_size(0),
-    next_index(0) { }
+    next_index(0),
+    index_count(0),
+    quads(true) { }
 
 void MeshBuilder::reset(MeshFormat format) {
     this->format = std::move(format);
     vert_size = 0;
     next_index = 0;
+    index_count = 0;
+    quads = true;
     buf.clear();
     ibuf.clear();
+    range_starts.clear();
 }
 
 MeshBuilder::Index MeshBuilder::finishVert() {
     assert(vert_size == format.getVertexSize());
     vert_size = 0;
+    writeOutQuads();
 
     ibuf.push_back(next_index);
+    index_count++;
     return next_index++;
 }
 
 void MeshBuilder::repeatVert(Index index) {
     assert(index < next_index);
+    writeOutQuads();
 
     ibuf.push_back(index);
+    index_count++;
+}
+
+void MeshBuilder::writeQuadIndices(Index first) {
+    const auto pos = ibuf.size();
+    ibuf.resize(pos + 6);
+    Index *indices = &ibuf[pos];
+    indices[0] = first;
+    indices[1] = indices[3] = first + 1;
+    indices[2] = indices[5] = first + 2;
+    indices[4] = first + 3;
+}
+
+void MeshBuilder::writeOutQuads() {
+    if (!quads) {
+        return;
+    }
+
+    quads = false;
+    for (Index first = 0; first < next_index; first += 4) {
+        writeQuadIndices(first);
+    }
 }
 
 void MeshBuilder::append(float f) {
-    buf.push_back(f);
-    vert_size++;
+    appendScalar(f);
 }
 
 void MeshBuilder::append(const glm::vec2 &vec) {
-    auto pos = buf.size();
-    buf.resize(pos+2);
-    buf[pos] = vec.x;
-    buf[pos+1] = vec.y;
-    vert_size += 2;
+    const float vals[] = { vec.x, vec.y };
+    appendFloats(vals, 2);
 }
 
 void MeshBuilder::append(const glm::vec3 &vec) {
-    auto pos = buf.size();
-    buf.resize(pos+3);
-    buf[pos] = vec.x;
-    buf[pos+1] = vec.y;
-    buf[pos+2] = vec.z;
-    vert_size += 3;
+    const float vals[] = { vec.x, vec.y, vec.z };
+    appendFloats(vals, 3);
 }
 
 void MeshBuilder::append(const glm::vec4 &vec) {
+    const float vals[] = { vec.x, vec.y, vec.z, vec.w };
+    appendFloats(vals, 4);
+}
+
+void MeshBuilder::appendFloats(const float *vals, unsigned int count) {
     auto pos = buf.size();
-    buf.resize(pos+4);
-    buf[pos] = vec.x;
-    buf[pos+1] = vec.y;
-    buf[pos+2] = vec.z;
-    buf[pos+3] = vec.w;
-    vert_size += 4;
+    buf.resize(pos+count*sizeof(float));
+    std::memcpy(&buf[pos], vals, count*sizeof(float));
+    vert_size += count*sizeof(float);
 }
 
 Mesh MeshBuilder::build() const {
+    if (quads) {
+        return {getVertexCount(), format, Buffer{buf}};
+    }
     return {getVertexCount(),
             format,
             Buffer{buf},
             Buffer{ibuf, Buffer::ELEMENTS}};
 }
 
+MeshData MeshBuilder::takeData(MeshData spare) {
+    spare.clear();
+    MeshData data;
+    std::swap(data.vertices, buf);
+    std::swap(data.indices, ibuf);
+    std::swap(data.range_starts, range_starts);
+    std::swap(buf, spare.vertices);
+    std::swap(ibuf, spare.indices);
+    std::swap(range_starts, spare.range_starts);
+    data.index_count = index_count;
+    data.quads = quads;
+    vert_size = 0;
+    next_index = 0;
+    index_count = 0;
+    quads = true;
+    return data;
+}
+
 Mesh::Mesh(unsigned int vertcount, const MeshFormat &format, Buffer buf_, Buffer ibuf_) :
     vertcount(vertcount),
     format(format),
@@ -81,27 +196,35 @@ Mesh::Mesh(unsigned int vertcount, const MeshFormat &format, Buffer buf_, Buffer
 {
     glBindVertexArray(vao.getID());
     glBindBuffer(GL_ARRAY_BUFFER, buf.getID());
+    format.setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibuf.getID());
 
-    const unsigned int vert_size = format.getVertexSize();
-    unsigned int offset = 0;
-    for (unsigned int attrib=0; attrib < format.getAttributeCount(); attrib++) {
-        const unsigned int size = format.getAttributeSize(attrib);
-        glEnableVertexAttribArray(attrib);
-        glVertexAttribPointer(attrib, size,
-                              GL_FLOAT, GL_FALSE, vert_size*4,
-                              reinterpret_cast<void *>(offset*4));
-        offset += size;
-    }
+    glBindVertexArray(0);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibuf.getID());
+Mesh::Mesh(unsigned int vertcount, const MeshFormat &format, Buffer buf_) :
+    vertcount(vertcount),
+    format(format),
+    vao(VertexArrayObject::generate()),
+    buf(std::move(buf_)),
+    quads(true)
+{
+    QuadIndexBuffer &quad_indices = QuadIndexBuffer::get();
+    quad_indices.reserve(vertcount / 6);
+
+    glBindVertexArray(vao.getID());
+    glBindBuffer(GL_ARRAY_BUFFER, buf.getID());
+    format.setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_indices.getBuffer().getID());
 
     glBindVertexArray(0);
 }
 
 void Mesh::draw(const ShaderProgram &prgm) const {
+    const GLenum type = quads ? QuadIndexBuffer::get().getType() : GL_UNSIGNED_INT;
     glUseProgram(prgm.getID());
     glBindVertexArray(vao.getID());
-    glDrawElements(GL_TRIANGLES, vertcount, GL_UNSIGNED_INT,
+    glDrawElements(GL_TRIANGLES, vertcount, type,
                    reinterpret_cast<void *>(0));
     glBindVertexArray(0);
 }
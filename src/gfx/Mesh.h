@@ -8,29 +8,79 @@
 #include <glm/glm.hpp>
 #include <initializer_list>
 #include <vector>
+#include <array>
+#include <iterator>
+#include <numeric>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 
 class MeshFormat {
 public:
-    MeshFormat() { }
+    enum class Type {
+        FLOAT,
+        BYTE,
+        UNSIGNED_BYTE,
+        SHORT,
+        UNSIGNED_SHORT,
+        INT,
+        UNSIGNED_INT
+    };
+
+    // How the shader sees an attribute. FLOAT converts integers directly,
+    // NORMALIZED maps them to [0, 1] or [-1, 1], INTEGER passes them
+    // through unconverted to int/uint shader inputs.
+    enum class Mode {
+        FLOAT,
+        NORMALIZED,
+        INTEGER
+    };
+
+    struct Attribute {
+        unsigned int length;
+        Type type;
+        Mode mode;
+    };
+
+    MeshFormat() : vert_size(0) { }
+    // All float attributes, with the given lengths
     explicit MeshFormat(const std::initializer_list<unsigned int> &attr_lengths);
+    explicit MeshFormat(const std::initializer_list<Attribute> &attrs);
 
+    // In bytes
     unsigned int getVertexSize() const { return vert_size; }
 
-    unsigned int getAttributeCount() const { return attr_lengths.size(); }
-    unsigned int getAttributeSize(unsigned int attribute) const { return attr_lengths[attribute]; }
+    unsigned int getAttributeCount() const { return attrs.size(); }
+    const Attribute &getAttribute(unsigned int attribute) const { return attrs[attribute]; }
+    unsigned int getAttributeOffset(unsigned int attribute) const { return offsets[attribute]; }
+
+    static unsigned int getTypeSize(Type type);
+
+    // Points attributes first to first+getAttributeCount()-1 of the bound
+    // vertex array at the bound GL_ARRAY_BUFFER, starting offset bytes in.
+    // A non-zero divisor makes them per instance rather than per vertex.
+    void setupAttributes(unsigned int first = 0, size_t offset = 0,
+                         unsigned int divisor = 0) const;
 
 private:
-    std::vector<unsigned int> attr_lengths;
+    std::vector<Attribute> attrs;
+    std::vector<unsigned int> offsets;
     unsigned int vert_size;
+
+    void computeLayout();
 };
 
 class Mesh {
 public:
     Mesh() : vertcount(0) { }
     Mesh(unsigned int vertcount, const MeshFormat &format, Buffer buf, Buffer ibuf);
+    // A quad mesh, drawn with QuadIndexBuffer's indices
+    Mesh(unsigned int vertcount, const MeshFormat &format, Buffer buf);
 
     unsigned int getVertexCount() const { return vertcount; }
     const MeshFormat &getFormat() const { return format; }
+    size_t getVertexBytes() const { return buf.getSize(); }
+    size_t getIndexBytes() const { return ibuf.getSize(); }
 
     explicit operator bool() const { return !!vao; }
 
@@ -43,8 +93,11 @@ private:
     VertexArrayObject vao;
     Buffer buf;
     Buffer ibuf;
+    bool quads = false;
 };
 
+struct MeshData;
+
 class MeshBuilder {
 public:
     using Index = unsigned int;
@@ -66,6 +119,12 @@ public:
     }
 
     void append(float f);
+    void append(int8_t i) { appendScalar(i); }
+    void append(uint8_t i) { appendScalar(i); }
+    void append(int16_t i) { appendScalar(i); }
+    void append(uint16_t i) { appendScalar(i); }
+    void append(int32_t i) { appendScalar(i); }
+    void append(uint32_t i) { appendScalar(i); }
     void append(const glm::vec2 &vec);
     void append(const glm::vec3 &vec);
     void append(const glm::vec4 &vec);
@@ -81,23 +140,116 @@ public:
         append(val);
         return makeVert(vals...);
     }
+
+    // Makes room for count more quads of appendQuad, so that building
+    // doesn't reallocate along the way
+    void reserveQuads(size_t count) {
+        buf.reserve(buf.size() + 4*count*format.getVertexSize());
+        ibuf.reserve(ibuf.size() + 6*count);
+    }
+
+    // Writes a whole quad in one go: four vertices, each made of the
+    // attributes at its position in attrs, interleaved in the order
+    // given, then the triangles 0 1 2 and 1 3 2. Returns the first
+    // vertex's index. While a mesh is nothing but quads its indices are
+    // only counted, not written (see isQuads).
+    template <typename... Attrs>
+    Index appendQuad(const std::array<Attrs, 4> &... attrs) {
+        const size_t sizes[] = {sizeof(Attrs)...};
+        const size_t size = std::accumulate(std::begin(sizes), std::end(sizes), size_t{0});
+        assert(vert_size == 0 && size == format.getVertexSize());
+
+        const auto pos = buf.size();
+        buf.resize(pos + 4*size);
+        uint8_t *out = &buf[pos];
+        for (int i = 0; i < 4; i++) {
+            using expand = int[];
+            (void)expand{0, (std::memcpy(out, &attrs[i], sizeof(Attrs)),
+                             out += sizeof(Attrs), 0)...};
+        }
+
+        const Index first = next_index;
+        next_index += 4;
+        index_count += 6;
+        if (!quads) {
+            writeQuadIndices(first);
+        }
+        return first;
+    }
     
+    // Starts a new range of indices, so that parts of the mesh can be
+    // drawn on their own. Range i runs from getRangeStart(i) up to the
+    // start of the next range, or the end of the indices.
+    void startRange() { range_starts.push_back(index_count); }
+    unsigned int getRangeCount() const { return range_starts.size() + 1; }
+    unsigned int getRangeStart(unsigned int range) const {
+        return range == 0 ? 0 : range_starts[range-1];
+    }
+    const std::vector<unsigned int> &getRangeStarts() const { return range_starts; }
+
     const MeshFormat &getFormat() const { return format; }
-    unsigned int getVertexCount() const { return ibuf.size(); }
+    unsigned int getVertexCount() const { return index_count; }
+    unsigned int getIndexCount() const { return index_count; }
+
+    // True while everything has gone through appendQuad, in which case
+    // the indices are those of QuadIndexBuffer and the index buffer is
+    // left empty. Any other vertex writes out the indices so far.
+    bool isQuads() const { return quads; }
 
-    const std::vector<float> &getBuffer() const { return buf; }
+    const std::vector<uint8_t> &getBuffer() const { return buf; }
     const std::vector<Index> &getIndexBuffer() const { return ibuf; }
 
     Mesh build() const;
+    // Moves the built vertices, indices and ranges out, leaving the
+    // builder empty, and carries on building into spare's buffers. Spare
+    // buffers from a MeshDataPool still have their capacity, so neither
+    // side needs to allocate.
+    MeshData takeData(MeshData spare);
     
 private:
     unsigned int vert_size;
     Index next_index;
+    unsigned int index_count;
+    bool quads;
 
-    std::vector<float> buf;
+    std::vector<uint8_t> buf;
     std::vector<Index> ibuf;
+    std::vector<unsigned int> range_starts;
 
     MeshFormat format;
+
+    void appendFloats(const float *vals, unsigned int count);
+    void writeQuadIndices(Index first);
+    void writeOutQuads();
+
+    template <typename T>
+    void appendScalar(T val) {
+        auto pos = buf.size();
+        buf.resize(pos+sizeof(T));
+        std::memcpy(&buf[pos], &val, sizeof(T));
+        vert_size += sizeof(T);
+    }
+};
+
+// A built mesh's data, on its own, for moving from the thread that
+// built it to the one uploading it. The format is left to the receiver.
+// Quad meshes (see MeshBuilder::isQuads) come without indices.
+struct MeshData {
+    std::vector<uint8_t> vertices;
+    std::vector<MeshBuilder::Index> indices;
+    std::vector<unsigned int> range_starts;
+    unsigned int index_count = 0;
+    bool quads = false;
+
+    bool empty() const { return index_count == 0; }
+    // Keeps the capacity
+    void clear() {
+        vertices.clear();
+        indices.clear();
+        range_starts.clear();
+        index_count = 0;
+        quads = false;
+    }
 };
 
 #endif
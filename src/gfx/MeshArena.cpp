@@ -0,0 +1,416 @@
+#include "gfx/MeshArena.h"
+#include "gfx/QuadIndexBuffer.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+
+ArenaMesh &ArenaMesh::operator=(ArenaMesh &&other) {
+    release();
+    arena = other.arena;
+    first_vertex = other.first_vertex;
+    vertex_count = other.vertex_count;
+    first_index = other.first_index;
+    index_count = other.index_count;
+    quads = other.quads;
+    range_starts = std::move(other.range_starts);
+    other.arena = nullptr;
+    return *this;
+}
+
+size_t ArenaMesh::getVertexBytes() const {
+    return arena ? vertex_count * arena->getFormat().getVertexSize() : 0;
+}
+
+size_t ArenaMesh::getIndexBytes() const {
+    return quads ? 0 : index_count * sizeof(MeshBuilder::Index);
+}
+
+void ArenaMesh::release() {
+    if (arena) {
+        arena->free(*this);
+        arena = nullptr;
+    }
+}
+
+MeshUpload &MeshUpload::operator=(MeshUpload &&other) {
+    release();
+    staging = other.staging;
+    range = other.range;
+    vertex_count = other.vertex_count;
+    data = std::move(other.data);
+    other.staging = nullptr;
+    return *this;
+}
+
+void MeshUpload::release() {
+    if (staging) {
+        staging->free(range);
+        staging = nullptr;
+    }
+}
+
+MeshArena::MeshArena(MeshFormat format_, size_t initial_vertices, size_t initial_indices,
+                     size_t staging_bytes) :
+    format(std::move(format_)),
+    multi_draw(GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance),
+    vao(VertexArrayObject::generate()),
+    vertices(initial_vertices),
+    indices(initial_indices)
+{
+    vbuf.setData(nullptr, initial_vertices * format.getVertexSize());
+    ibuf.setData(nullptr, initial_indices * sizeof(MeshBuilder::Index), Buffer::ELEMENTS);
+    offsetbuf.setData(nullptr, sizeof(glm::vec4));
+    cmdbuf.setData(nullptr, sizeof(DrawCommand), Buffer::DRAW_INDIRECT);
+    setupVertexArray();
+
+    if (staging_bytes > 0 && StagingBuffer::isSupported()) {
+        staging.reset(new StagingBuffer{staging_bytes});
+    }
+}
+
+void MeshArena::setVertexTexture(unsigned int texel_format) {
+    max_vertices = getMaxTextureBufferBytes(texel_format) / format.getVertexSize();
+    if (vertices.getSize() > max_vertices) {
+        std::stringstream msg;
+        msg << "Mesh arena of " << vertices.getSize() << " vertices is past the "
+            << max_vertices << " its vertex texture can show";
+        throw std::runtime_error(msg.str());
+    }
+
+    vertex_texture_format = texel_format;
+    vertex_texture.setBuffer(vbuf, texel_format);
+}
+
+size_t MeshArena::getMaxTextureBufferBytes(unsigned int texel_format) {
+    size_t texel_size = 0;
+    switch (texel_format) {
+    case GL_R32UI: case GL_R32I: case GL_R32F: case GL_RG16UI: case GL_RGBA8UI:
+        texel_size = 4;
+        break;
+    case GL_RG32UI: case GL_RG32I: case GL_RG32F: case GL_RGBA16UI:
+        texel_size = 8;
+        break;
+    case GL_RGBA32UI: case GL_RGBA32I: case GL_RGBA32F:
+        texel_size = 16;
+        break;
+    default:
+        assert(!"unsupported vertex texture format");
+    }
+
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    return static_cast<size_t>(max_texels) * texel_size;
+}
+
+ArenaMesh MeshArena::allocate(const MeshBuilder &builder) {
+    return upload(builder.getBuffer(), builder.getIndexBuffer(),
+                  builder.getIndexCount(), builder.isQuads(), builder.getRangeStarts());
+}
+
+ArenaMesh MeshArena::allocate(const MeshData &data) {
+    return upload(data.vertices, data.indices, data.index_count, data.quads,
+                  data.range_starts);
+}
+
+ArenaMesh MeshArena::upload(const std::vector<uint8_t> &vertdata,
+                            const std::vector<MeshBuilder::Index> &indexdata,
+                            size_t index_count, bool quads,
+                            const std::vector<unsigned int> &range_starts) {
+    if (index_count == 0) {
+        return ArenaMesh{};
+    }
+
+    const size_t vert_size = format.getVertexSize();
+    const size_t index_size = sizeof(MeshBuilder::Index);
+    ArenaMesh mesh = allocateMesh(vertdata.size() / vert_size, index_count, quads,
+                                  range_starts);
+
+    // Indices stay relative to the mesh, draws add first_vertex
+    vbuf.setSubData(mesh.first_vertex * vert_size, &vertdata.front(),
+                    vertdata.size(), Buffer::ARRAY);
+    if (!quads) {
+        ibuf.setSubData(mesh.first_index * index_size, &indexdata.front(),
+                        indexdata.size() * index_size, Buffer::ELEMENTS);
+    }
+    return mesh;
+}
+
+static size_t getIndexOffset(size_t vertex_bytes) {
+    const size_t align = sizeof(MeshBuilder::Index);
+    return (vertex_bytes + align - 1) / align * align;
+}
+
+MeshUpload MeshArena::stage(MeshData data) {
+    MeshUpload upload;
+    const size_t vertex_bytes = data.vertices.size();
+    const size_t index_bytes = data.quads ? 0 : data.indices.size() * sizeof(MeshBuilder::Index);
+    // Indices go after the vertices, aligned
+    const size_t index_offset = getIndexOffset(vertex_bytes);
+
+    StagingBuffer::Range range;
+    if (!data.empty() && staging &&
+        staging->allocate(index_offset + index_bytes, range)) {
+        uint8_t *dest = staging->getPointer(range);
+        std::memcpy(dest, &data.vertices.front(), vertex_bytes);
+        if (index_bytes > 0) {
+            std::memcpy(dest + index_offset, &data.indices.front(), index_bytes);
+        }
+
+        upload.staging = staging.get();
+        upload.range = range;
+        upload.vertex_count = vertex_bytes / format.getVertexSize();
+    }
+    upload.data = std::move(data);
+    return upload;
+}
+
+ArenaMesh MeshArena::allocate(MeshUpload &upload) {
+    if (!upload.isStaged()) {
+        return allocate(upload.data);
+    }
+
+    const size_t vert_size = format.getVertexSize();
+    const size_t index_size = sizeof(MeshBuilder::Index);
+    const size_t vertex_bytes = upload.vertex_count * vert_size;
+    const size_t index_count = upload.data.index_count;
+    const bool quads = upload.data.quads;
+    ArenaMesh mesh = allocateMesh(upload.vertex_count, index_count, quads,
+                                  upload.data.range_starts);
+
+    staging->copy(upload.range, 0, vertex_bytes,
+                  vbuf, mesh.first_vertex * vert_size);
+    if (!quads) {
+        staging->copy(upload.range, getIndexOffset(vertex_bytes), index_count * index_size,
+                      ibuf, mesh.first_index * index_size);
+    }
+    staging->release(upload.range);
+    upload.staging = nullptr;
+    return mesh;
+}
+
+void MeshArena::retireUploads() {
+    if (staging) {
+        staging->retire();
+    }
+}
+
+ArenaMesh MeshArena::allocateMesh(size_t vertex_count, size_t index_count, bool quads,
+                                  const std::vector<unsigned int> &range_starts) {
+    ArenaMesh mesh;
+    mesh.vertex_count = vertex_count;
+    mesh.index_count = index_count;
+    mesh.quads = quads;
+    mesh.first_vertex = allocateRange(vertices, vbuf, Buffer::ARRAY,
+                                      format.getVertexSize(), vertex_count);
+    if (quads) {
+        QuadIndexBuffer::get().reserve(index_count / 6);
+    } else {
+        mesh.first_index = allocateRange(indices, ibuf, Buffer::ELEMENTS,
+                                         sizeof(MeshBuilder::Index), index_count);
+    }
+    mesh.range_starts = range_starts;
+    mesh.arena = this;
+    return mesh;
+}
+
+void MeshArena::addDraw(const ArenaMesh &mesh, const glm::vec3 &offset,
+                        uint32_t ranges) {
+    if (!mesh) {
+        return;
+    }
+
+    // Every command of this mesh picks its offset out of offsetbuf
+    const uint32_t instance = offsets.size();
+    bool used = false;
+
+    const unsigned int range_count = mesh.range_starts.size() + 1;
+    unsigned int range = 0;
+    while (range < range_count) {
+        if (!(ranges & (1u << range))) {
+            range++;
+            continue;
+        }
+
+        const size_t start = range == 0 ? 0 : mesh.range_starts[range-1];
+        while (range < range_count && (ranges & (1u << range))) {
+            range++;
+        }
+        const size_t end = range == range_count ? mesh.index_count : mesh.range_starts[range-1];
+        if (start == end) {
+            continue;
+        }
+
+        DrawCommand cmd;
+        cmd.count = end - start;
+        cmd.instance_count = 1;
+        cmd.first_index = mesh.first_index + start;
+        cmd.base_vertex = mesh.first_vertex;
+        cmd.base_instance = instance;
+        (mesh.quads ? quad_commands : commands).push_back(cmd);
+        queued_index_count += cmd.count;
+        used = true;
+    }
+
+    if (used) {
+        offsets.push_back(glm::vec4{offset, 0});
+    }
+}
+
+void MeshArena::draw(const ShaderProgram &prgm) {
+    last_draw_count = commands.size() + quad_commands.size();
+    last_index_count = queued_index_count;
+    queued_index_count = 0;
+    if (last_draw_count == 0) {
+        return;
+    }
+
+    glUseProgram(prgm.getID());
+    glBindVertexArray(vao.getID());
+    if (multi_draw) {
+        // Both lists go in the one command buffer, the quads' after
+        offsetbuf.setData(&offsets.front(), offsets.size() * sizeof(glm::vec4));
+        commands.insert(commands.end(), quad_commands.begin(), quad_commands.end());
+        cmdbuf.setData(&commands.front(), commands.size() * sizeof(DrawCommand),
+                       Buffer::DRAW_INDIRECT);
+        commands.resize(commands.size() - quad_commands.size());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmdbuf.getID());
+    }
+
+    const QuadIndexBuffer &quad_indices = QuadIndexBuffer::get();
+    drawCommands(commands, 0, ibuf, GL_UNSIGNED_INT, sizeof(MeshBuilder::Index));
+    drawCommands(quad_commands, commands.size(), quad_indices.getBuffer(),
+                 quad_indices.getType(), quad_indices.getIndexSize());
+
+    if (multi_draw) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibuf.getID());
+    glBindVertexArray(0);
+
+    commands.clear();
+    quad_commands.clear();
+    offsets.clear();
+}
+
+void MeshArena::drawCommands(const std::vector<DrawCommand> &cmds, size_t cmd_offset,
+                             const Buffer &elements, unsigned int type, size_t index_size) {
+    if (cmds.empty()) {
+        return;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elements.getID());
+    if (multi_draw) {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, type,
+                                    reinterpret_cast<void *>(cmd_offset * sizeof(DrawCommand)),
+                                    cmds.size(), 0);
+    } else {
+        // Without base instances, fall back to a draw per mesh, with the
+        // offset as a constant attribute
+        const unsigned int offset_attrib = getOffsetAttribute();
+        glDisableVertexAttribArray(offset_attrib);
+        for (const DrawCommand &cmd : cmds) {
+            const glm::vec4 &offset = offsets[cmd.base_instance];
+            glVertexAttrib3f(offset_attrib, offset.x, offset.y, offset.z);
+            glDrawElementsBaseVertex(
+                GL_TRIANGLES, cmd.count, type,
+                reinterpret_cast<void *>(cmd.first_index * index_size),
+                cmd.base_vertex);
+        }
+        glEnableVertexAttribArray(offset_attrib);
+    }
+}
+
+size_t MeshArena::getVertexBytes() const {
+    return vertices.getSize() * format.getVertexSize();
+}
+
+size_t MeshArena::getUsedVertexBytes() const {
+    return vertices.getUsed() * format.getVertexSize();
+}
+
+size_t MeshArena::getIndexBytes() const {
+    return indices.getSize() * sizeof(MeshBuilder::Index);
+}
+
+size_t MeshArena::getUsedIndexBytes() const {
+    return indices.getUsed() * sizeof(MeshBuilder::Index);
+}
+
+size_t MeshArena::getStagingBytes() const {
+    return staging ? staging->getSize() : 0;
+}
+
+size_t MeshArena::getUsedStagingBytes() const {
+    return staging ? staging->getUsed() : 0;
+}
+
+void MeshArena::free(const ArenaMesh &mesh) {
+    vertices.free(mesh.first_vertex, mesh.vertex_count);
+    if (!mesh.quads) {
+        indices.free(mesh.first_index, mesh.index_count);
+    }
+}
+
+size_t MeshArena::allocateRange(RangeAllocator &alloc, Buffer &buf,
+                                Buffer::Type type, size_t unit, size_t count) {
+    auto offset = alloc.allocate(count);
+    if (offset) {
+        return *offset;
+    }
+
+    // Out of room, so double the buffer (or more) and copy everything
+    // over, short of what the vertex texture can show
+    const size_t limit = &buf == &vbuf ? max_vertices : std::numeric_limits<size_t>::max();
+    const size_t newsize = std::min(std::max(2*alloc.getSize(), alloc.getSize() + count),
+                                    limit);
+    if (newsize <= alloc.getSize()) {
+        throwFull(alloc, count);
+    }
+    Buffer newbuf;
+    newbuf.setData(nullptr, newsize * unit, type);
+    glBindBuffer(GL_COPY_READ_BUFFER, buf.getID());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newbuf.getID());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        0, 0, alloc.getSize() * unit);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    buf = std::move(newbuf);
+    alloc.grow(newsize);
+    setupVertexArray();
+    if (&buf == &vbuf && vertex_texture_format) {
+        vertex_texture.setBuffer(vbuf, vertex_texture_format);
+    }
+
+    offset = alloc.allocate(count);
+    if (!offset) {
+        throwFull(alloc, count);
+    }
+    return *offset;
+}
+
+void MeshArena::throwFull(const RangeAllocator &alloc, size_t count) {
+    std::stringstream msg;
+    msg << "Mesh arena can't fit " << count << " more vertices in "
+        << alloc.getSize() << ", the most its vertex texture can show";
+    throw std::runtime_error(msg.str());
+}
+
+void MeshArena::setupVertexArray() {
+    glBindVertexArray(vao.getID());
+    glBindBuffer(GL_ARRAY_BUFFER, vbuf.getID());
+    format.setupAttributes();
+
+    const unsigned int offset_attrib = getOffsetAttribute();
+    glBindBuffer(GL_ARRAY_BUFFER, offsetbuf.getID());
+    glEnableVertexAttribArray(offset_attrib);
+    glVertexAttribPointer(offset_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+    glVertexAttribDivisor(offset_attrib, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibuf.getID());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
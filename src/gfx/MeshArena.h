@@ -0,0 +1,196 @@
+#ifndef MESHARENA_H
+#define MESHARENA_H
+
+#include "gfx/Mesh.h"
+#include "gfx/StagingBuffer.h"
+#include "gfx/Texture.h"
+#include "util/RangeAllocator.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <limits>
+
+class MeshArena;
+
+// A mesh stored in a range of a MeshArena's buffers. The range is freed
+// when the mesh is destroyed, so the arena must outlive its meshes.
+class ArenaMesh {
+public:
+    ArenaMesh() { }
+    ArenaMesh(const ArenaMesh &) = delete;
+    ArenaMesh(ArenaMesh &&other) { *this = std::move(other); }
+    ~ArenaMesh() { release(); }
+
+    ArenaMesh &operator=(const ArenaMesh &) = delete;
+    ArenaMesh &operator=(ArenaMesh &&other);
+
+    explicit operator bool() const { return arena != nullptr; }
+
+    size_t getVertexCount() const { return vertex_count; }
+    size_t getIndexCount() const { return index_count; }
+    size_t getVertexBytes() const;
+    size_t getIndexBytes() const;
+
+private:
+    friend class MeshArena;
+
+    MeshArena *arena = nullptr;
+    size_t first_vertex = 0;
+    size_t vertex_count = 0;
+    size_t first_index = 0;
+    size_t index_count = 0;
+    // Quad meshes use QuadIndexBuffer's indices rather than the arena's
+    bool quads = false;
+    // See MeshBuilder::startRange
+    std::vector<unsigned int> range_starts;
+
+    void release();
+};
+
+// A mesh on its way into a MeshArena, made by MeshArena::stage on any
+// thread. Its vertices and indices are already written to the arena's
+// staging buffer if there was room, or left in its data for allocate to
+// upload if not. Like an ArenaMesh, it mustn't outlive the arena, so
+// uploads held by queued work need the work dropped first (see
+// ThreadManager::stopThreads).
+class MeshUpload {
+public:
+    MeshUpload() { }
+    MeshUpload(const MeshUpload &) = delete;
+    MeshUpload(MeshUpload &&other) { *this = std::move(other); }
+    ~MeshUpload() { release(); }
+
+    MeshUpload &operator=(const MeshUpload &) = delete;
+    MeshUpload &operator=(MeshUpload &&other);
+
+    bool isStaged() const { return staging != nullptr; }
+    // The data the upload was staged from, to be recycled once the
+    // upload has been allocated
+    MeshData takeData() { return std::move(data); }
+
+private:
+    friend class MeshArena;
+
+    StagingBuffer *staging = nullptr;
+    StagingBuffer::Range range;
+    size_t vertex_count = 0;
+    MeshData data;
+
+    void release();
+};
+
+// One vertex buffer and one index buffer shared by all the meshes of a
+// format, so that a frame's worth of them draws in a single
+// glMultiDrawElementsIndirect instead of a bind and draw each. Quad
+// meshes take no room in the index buffer, and draw from QuadIndexBuffer
+// in a second glMultiDrawElementsIndirect. Each draw also gets an
+// offset, added to the vertex positions through the attribute after the
+// format's own (see getOffsetAttribute).
+class MeshArena {
+public:
+    // Uploads are staged through staging_bytes of mapped memory, where
+    // supported
+    MeshArena(MeshFormat format, size_t initial_vertices, size_t initial_indices,
+              size_t staging_bytes = 0);
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    const MeshFormat &getFormat() const { return format; }
+    unsigned int getOffsetAttribute() const { return format.getAttributeCount(); }
+
+    // Also makes the vertex buffer readable as a buffer texture of texels
+    // in texel_format (GL_RG32UI, ...), for shaders that fetch vertex
+    // data themselves, such as vert.glsl does face records. The texture
+    // follows the buffer as it grows, up to GL_MAX_TEXTURE_BUFFER_SIZE
+    // texels, past which allocating throws std::runtime_error, as does
+    // this if the buffer is already bigger.
+    void setVertexTexture(unsigned int texel_format);
+    const BufferTexture &getVertexTexture() const { return vertex_texture; }
+    // The most vertices the arena can grow to hold
+    size_t getMaxVertices() const { return max_vertices; }
+    // The most bytes a buffer texture of texel_format can show
+    static size_t getMaxTextureBufferBytes(unsigned int texel_format);
+
+    // Copies the builder's mesh into the arena, growing it if need be.
+    // Empty builders give empty meshes.
+    ArenaMesh allocate(const MeshBuilder &builder);
+    ArenaMesh allocate(const MeshData &data);
+    // Thread safe. Writes the mesh into mapped memory, so that allocating
+    // it only queues a copy on the GPU, rather than sending the data
+    // through the driver on the main thread.
+    MeshUpload stage(MeshData data);
+    ArenaMesh allocate(MeshUpload &upload);
+    // Frees up the staging space of finished uploads. Call about once a
+    // frame.
+    void retireUploads();
+
+    // Queues mesh to be drawn, translated by offset, by the next draw().
+    // Only the index ranges in the ranges bitmask are drawn, with
+    // neighbouring ranges merged into one draw.
+    void addDraw(const ArenaMesh &mesh, const glm::vec3 &offset,
+                 uint32_t ranges = ~0u);
+    void draw(const ShaderProgram &prgm);
+
+    size_t getVertexBytes() const;
+    size_t getUsedVertexBytes() const;
+    size_t getIndexBytes() const;
+    size_t getUsedIndexBytes() const;
+    size_t getStagingBytes() const;
+    size_t getUsedStagingBytes() const;
+    unsigned int getLastDrawCount() const { return last_draw_count; }
+    size_t getLastIndexCount() const { return last_index_count; }
+
+private:
+    friend class ArenaMesh;
+
+    // Laid out as GL expects for glMultiDrawElementsIndirect
+    struct DrawCommand {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t base_instance;
+    };
+
+    MeshFormat format;
+    bool multi_draw;
+
+    VertexArrayObject vao;
+    Buffer vbuf;
+    Buffer ibuf;
+    Buffer offsetbuf;
+    Buffer cmdbuf;
+    BufferTexture vertex_texture;
+    unsigned int vertex_texture_format = 0;
+    size_t max_vertices = std::numeric_limits<size_t>::max();
+    RangeAllocator vertices;
+    RangeAllocator indices;
+    // Null without GL_ARB_buffer_storage, leaving every upload to
+    // allocate
+    std::unique_ptr<StagingBuffer> staging;
+
+    std::vector<DrawCommand> commands;
+    std::vector<DrawCommand> quad_commands;
+    std::vector<glm::vec4> offsets;
+    unsigned int last_draw_count = 0;
+    size_t last_index_count = 0;
+    size_t queued_index_count = 0;
+
+    void free(const ArenaMesh &mesh);
+    ArenaMesh allocateMesh(size_t vertex_count, size_t index_count, bool quads,
+                           const std::vector<unsigned int> &range_starts);
+    ArenaMesh upload(const std::vector<uint8_t> &vertdata,
+                     const std::vector<MeshBuilder::Index> &indexdata,
+                     size_t index_count, bool quads,
+                     const std::vector<unsigned int> &range_starts);
+    void drawCommands(const std::vector<DrawCommand> &cmds, size_t cmd_offset,
+                      const Buffer &elements, unsigned int type, size_t index_size);
+    size_t allocateRange(RangeAllocator &alloc, Buffer &buf,
+                         Buffer::Type type, size_t unit, size_t count);
+    static void throwFull(const RangeAllocator &alloc, size_t count);
+    void setupVertexArray();
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "gfx/MeshDataPool.h"
+
+MeshDataPool::MeshDataPool(size_t max_size) :
+    max_size(max_size)
+{
+    spares.reserve(max_size);
+}
+
+MeshData MeshDataPool::take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (spares.empty()) {
+        return MeshData{};
+    }
+
+    MeshData data = std::move(spares.back());
+    spares.pop_back();
+    return data;
+}
+
+void MeshDataPool::recycle(MeshData data) {
+    data.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (spares.size() < max_size) {
+        spares.push_back(std::move(data));
+    }
+}
+
+size_t MeshDataPool::getSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spares.size();
+}
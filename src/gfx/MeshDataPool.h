@@ -0,0 +1,29 @@
+#ifndef MESHDATAPOOL_H
+#define MESHDATAPOOL_H
+
+#include "gfx/Mesh.h"
+
+#include <vector>
+#include <mutex>
+
+// Used MeshData kept for its buffers' capacity, so that a steady stream
+// of meshes passed from the workers to the main thread reuses the same
+// memory rather than allocating. Thread safe.
+class MeshDataPool {
+public:
+    // Holds on to at most max_size spares, dropping the rest
+    explicit MeshDataPool(size_t max_size);
+
+    // A spare, or new empty data if there are none
+    MeshData take();
+    void recycle(MeshData data);
+
+    size_t getSize() const;
+
+private:
+    size_t max_size;
+    mutable std::mutex mutex;
+    std::vector<MeshData> spares;
+};
+
+#endif
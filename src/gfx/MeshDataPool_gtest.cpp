@@ -0,0 +1,55 @@
+#include "MeshDataPool.h"
+#include <gtest/gtest.h>
+
+static void buildQuad(MeshBuilder &builder) {
+    builder.reset(MeshFormat{3});
+    builder.startRange();
+    auto a = builder.makeVert(glm::vec3{0, 0, 0});
+    auto b = builder.makeVert(glm::vec3{1, 0, 0});
+    auto c = builder.makeVert(glm::vec3{1, 1, 0});
+    builder.makeVert(glm::vec3{0, 1, 0});
+    builder.repeatVert(a);
+    builder.repeatVert(c);
+    (void)b;
+}
+
+TEST(MeshDataPool, TakeDataMovesMeshOut) {
+    MeshBuilder builder;
+    buildQuad(builder);
+    MeshData data = builder.takeData(MeshData{});
+
+    EXPECT_EQ(4*3*sizeof(float), data.vertices.size());
+    EXPECT_EQ(6u, data.indices.size());
+    EXPECT_EQ(std::vector<unsigned int>{0}, data.range_starts);
+    EXPECT_TRUE(builder.getBuffer().empty());
+    EXPECT_TRUE(builder.getIndexBuffer().empty());
+    EXPECT_EQ(1u, builder.getRangeCount());
+}
+
+TEST(MeshDataPool, BuilderReusesRecycledBuffers) {
+    MeshDataPool pool{4};
+    MeshBuilder builder;
+    buildQuad(builder);
+    MeshData first = builder.takeData(pool.take());
+    const uint8_t *vertices = first.vertices.data();
+    pool.recycle(std::move(first));
+    EXPECT_EQ(1u, pool.getSize());
+
+    // The builder gets the recycled buffers, and builds into them
+    MeshData second = builder.takeData(pool.take());
+    EXPECT_EQ(0u, pool.getSize());
+    EXPECT_TRUE(second.empty());
+    buildQuad(builder);
+    EXPECT_EQ(vertices, builder.getBuffer().data());
+}
+
+TEST(MeshDataPool, DropsSparesOverMaxSize) {
+    MeshDataPool pool{2};
+    for (int i = 0; i < 3; i++) {
+        MeshData data;
+        data.indices.push_back(i);
+        pool.recycle(std::move(data));
+    }
+    EXPECT_EQ(2u, pool.getSize());
+    EXPECT_TRUE(pool.take().empty());
+}
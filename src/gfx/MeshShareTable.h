@@ -0,0 +1,171 @@
+#ifndef MESHSHARETABLE_H
+#define MESHSHARETABLE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Meshes shared between everything with the same contents, by a key
+// hashed from them, and the keys of those being built. The first to
+// claim a key builds its mesh and shares it, while the rest find it, or
+// wait for it. Meshes are dropped from the table along with their last
+// reference, on whichever thread lets go of it.
+//
+// Claiming and finding are thread safe. The mesh the table hands out
+// must not outlive it.
+template <typename Mesh, typename Waiter>
+class MeshShareTable {
+public:
+    using SharedMesh = std::shared_ptr<const Mesh>;
+
+    // Keys are compared in full, so both halves must collide for two
+    // meshes to be mixed up
+    struct Key {
+        uint64_t hash;
+        uint64_t check;
+
+        bool operator==(const Key &other) const {
+            return hash == other.hash && check == other.check;
+        }
+        bool operator!=(const Key &other) const { return !(*this == other); }
+    };
+
+    // Given them, on_add is called on each mesh as it enters the table,
+    // and on_drop before it's deleted
+    using Callback = std::function<void(const Mesh &)>;
+    explicit MeshShareTable(Callback on_add = nullptr, Callback on_drop = nullptr) :
+        on_add(std::move(on_add)), on_drop(std::move(on_drop)) { }
+
+    MeshShareTable(const MeshShareTable &) = delete;
+    MeshShareTable &operator=(const MeshShareTable &) = delete;
+
+    SharedMesh find(const Key &key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = slots.find(key);
+        return iter == slots.end() ? nullptr : iter->second.mesh.lock();
+    }
+
+    // The mesh for key if there is one. If not, building is set if the
+    // caller is to build it, and share or release it, rather than wait on
+    // whoever already is.
+    SharedMesh claim(const Key &key, bool &building) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot &slot = slots[key];
+        if (SharedMesh mesh = slot.mesh.lock()) {
+            building = false;
+            return mesh;
+        }
+
+        building = !slot.building;
+        slot.building = true;
+        return nullptr;
+    }
+
+    // Keeps waiter until key's claim is shared or released, which hand it
+    // back. False, keeping nothing, if key isn't claimed, in which case
+    // its mesh may have been shared, and released, since claim.
+    bool wait(const Key &key, Waiter waiter) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = slots.find(key);
+        if (iter == slots.end() || !iter->second.building) {
+            return false;
+        }
+        iter->second.waiters.push_back(std::move(waiter));
+        return true;
+    }
+
+    // Ends the claim on key without a mesh, moving anything waiting on it
+    // into waiters, which must build it themselves
+    void release(const Key &key, std::vector<Waiter> &waiters) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = slots.find(key);
+        if (iter == slots.end()) {
+            return;
+        }
+        takeWaiters(iter->second, waiters);
+        if (iter->second.mesh.expired()) {
+            slots.erase(iter);
+        }
+    }
+
+    // Ends the claim on key with mesh, moving anything waiting on it into
+    // waiters, to be given it. Should another mesh with the same key have
+    // got in first, that one is returned and mesh dropped.
+    SharedMesh share(const Key &key, Mesh mesh, std::vector<Waiter> &waiters) {
+        SharedMesh shared;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Slot &slot = slots[key];
+            takeWaiters(slot, waiters);
+            if ((shared = slot.mesh.lock())) {
+                return shared;
+            }
+            shared = SharedMesh{new Mesh{std::move(mesh)}, Deleter{this, key}};
+            slot.mesh = shared;
+        }
+
+        // Outside the lock, in case it calls back in
+        if (on_add) {
+            on_add(*shared);
+        }
+        return shared;
+    }
+
+    // Meshes in the table, and keys claimed but not yet shared
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slots.size();
+    }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return static_cast<size_t>(key.hash); }
+    };
+
+    struct Slot {
+        std::weak_ptr<const Mesh> mesh;
+        bool building = false;
+        std::vector<Waiter> waiters;
+    };
+
+    struct Deleter {
+        MeshShareTable *table;
+        Key key;
+
+        void operator()(const Mesh *mesh) const {
+            {
+                std::lock_guard<std::mutex> lock(table->mutex);
+                // Unless the same key was shared again since the last
+                // reference went, or claimed for rebuilding
+                auto iter = table->slots.find(key);
+                if (iter != table->slots.end() && iter->second.mesh.expired() &&
+                    !iter->second.building) {
+                    table->slots.erase(iter);
+                }
+            }
+            if (table->on_drop) {
+                table->on_drop(*mesh);
+            }
+            delete mesh;
+        }
+    };
+
+    static void takeWaiters(Slot &slot, std::vector<Waiter> &waiters) {
+        slot.building = false;
+        for (Waiter &waiter : slot.waiters) {
+            waiters.push_back(std::move(waiter));
+        }
+        slot.waiters.clear();
+    }
+
+    Callback on_add;
+    Callback on_drop;
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Slot, KeyHash> slots;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "MeshShareTable.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+
+namespace {
+struct TestMesh {
+    int id;
+};
+
+struct ShareFixture {
+    long added = 0;
+    long dropped = 0;
+    using Table = MeshShareTable<TestMesh, int>;
+    Table table{[this](const TestMesh &) { added++; },
+                [this](const TestMesh &) { dropped++; }};
+    std::vector<int> waiters;
+};
+
+const MeshShareTable<TestMesh, int>::Key key{1, 2};
+}
+
+TEST(MeshShareTable, IdenticalContentsShareOneMesh) {
+    ShareFixture f;
+    bool building = false;
+    EXPECT_EQ(nullptr, f.table.claim(key, building));
+    EXPECT_TRUE(building);
+    // Whoever comes next waits on the first
+    EXPECT_EQ(nullptr, f.table.claim(key, building));
+    EXPECT_FALSE(building);
+
+    auto mesh = f.table.share(key, TestMesh{7}, f.waiters);
+    EXPECT_EQ(7, mesh->id);
+    EXPECT_EQ(mesh, f.table.find(key));
+    EXPECT_EQ(mesh, f.table.claim(key, building));
+    EXPECT_FALSE(building);
+    EXPECT_EQ(1, f.added);
+
+    // A mesh built for the same key meanwhile gives way to the first
+    EXPECT_EQ(mesh, f.table.share(key, TestMesh{8}, f.waiters));
+    EXPECT_EQ(1, f.added);
+    EXPECT_EQ(0, f.dropped);
+}
+
+TEST(MeshShareTable, HalfMatchingKeysDontShare) {
+    ShareFixture f;
+    bool building = false;
+    f.table.claim(key, building);
+    auto mesh = f.table.share(key, TestMesh{7}, f.waiters);
+
+    const ShareFixture::Table::Key other{key.hash, key.check + 1};
+    EXPECT_EQ(nullptr, f.table.find(other));
+    EXPECT_EQ(nullptr, f.table.claim(other, building));
+    EXPECT_TRUE(building);
+}
+
+TEST(MeshShareTable, LastReferenceErases) {
+    ShareFixture f;
+    bool building = false;
+    f.table.claim(key, building);
+    auto first = f.table.share(key, TestMesh{7}, f.waiters);
+    auto second = f.table.find(key);
+    EXPECT_EQ(1u, f.table.size());
+
+    first.reset();
+    EXPECT_EQ(second, f.table.find(key));
+    EXPECT_EQ(0, f.dropped);
+
+    second.reset();
+    EXPECT_EQ(1, f.dropped);
+    EXPECT_EQ(0u, f.table.size());
+    EXPECT_EQ(nullptr, f.table.find(key));
+
+    // And the key can be claimed afresh
+    EXPECT_EQ(nullptr, f.table.claim(key, building));
+    EXPECT_TRUE(building);
+}
+
+TEST(MeshShareTable, WaitersGetTheSharedMesh) {
+    ShareFixture f;
+    bool building = false;
+    f.table.claim(key, building);
+    f.table.claim(key, building);
+    EXPECT_TRUE(f.table.wait(key, 1));
+    EXPECT_TRUE(f.table.wait(key, 2));
+
+    f.table.share(key, TestMesh{7}, f.waiters);
+    EXPECT_EQ((std::vector<int>{1, 2}), f.waiters);
+
+    // Nothing's waited on after that, the mesh is there to be found
+    EXPECT_FALSE(f.table.wait(key, 3));
+}
+
+// The builder gives up on its claim, say because its chunk went away,
+// while another section waits on it
+TEST(MeshShareTable, ReleasedClaimHandsBackWaiters) {
+    ShareFixture f;
+    bool building = false;
+    f.table.claim(key, building);
+    ASSERT_TRUE(building);
+    f.table.claim(key, building);
+    ASSERT_FALSE(building);
+    EXPECT_TRUE(f.table.wait(key, 1));
+
+    f.table.release(key, f.waiters);
+    EXPECT_EQ(std::vector<int>{1}, f.waiters);
+    EXPECT_EQ(0u, f.table.size());
+    EXPECT_EQ(nullptr, f.table.find(key));
+
+    // The waiter has to build it, and can claim it to
+    EXPECT_EQ(nullptr, f.table.claim(key, building));
+    EXPECT_TRUE(building);
+}
+
+// A section that finds neither a mesh nor anyone building one can't wait
+// on it, so it never waits on something that won't come
+TEST(MeshShareTable, NoWaitingWithoutClaim) {
+    ShareFixture f;
+    EXPECT_FALSE(f.table.wait(key, 1));
+
+    bool building = false;
+    f.table.claim(key, building);
+    auto mesh = f.table.share(key, TestMesh{7}, f.waiters);
+    mesh.reset();
+    EXPECT_FALSE(f.table.wait(key, 1));
+    EXPECT_TRUE(f.waiters.empty());
+}
+
+TEST(MeshShareTable, OneClaimantAcrossThreads) {
+    ShareFixture f;
+    std::atomic<int> builders{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&]() {
+            bool building = false;
+            f.table.claim(key, building);
+            builders += building;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(1, builders.load());
+}
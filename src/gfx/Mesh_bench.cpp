@@ -0,0 +1,90 @@
+#include "Mesh.h"
+#include "ChunkVertex.h"
+#include "util/Benchmark.h"
+#include <array>
+
+// Writing a chunk's worth of quads, as the greedy mesher does, a
+// vertex at a time through makeChunkVert or a quad at a time through
+// makeChunkQuad
+static constexpr int QuadCount = 1024;
+
+static void benchChunkQuads(BenchmarkState &state, bool bulk) {
+    MeshBuilder builder;
+    while (state.keepRunning()) {
+        builder.reset(chunkMeshFormat());
+        for (int i = 0; i < QuadCount; i++) {
+            const glm::ivec3 pos{i % 32, (i / 32) % 32, 7};
+            const ChunkNormal normal = ChunkNormal::TOP;
+            const std::array<glm::ivec3, 4> corners{{
+                pos, pos + glm::ivec3{1, 0, 0}, pos + glm::ivec3{0, 1, 0}, pos + glm::ivec3{1, 1, 0}}};
+            const std::array<glm::ivec3, 4> texes{{
+                glm::ivec3{0, 0, 3}, glm::ivec3{1, 0, 3}, glm::ivec3{0, 1, 3}, glm::ivec3{1, 1, 3}}};
+            const std::array<uint8_t, 4> shades{{255, 204, 204, 166}};
+
+            if (bulk) {
+                makeChunkQuad(builder, corners, normal, texes, shades);
+            } else {
+                makeChunkVert(builder, corners[0], normal, texes[0], shades[0]);
+                auto a = makeChunkVert(builder, corners[1], normal, texes[1], shades[1]);
+                auto b = makeChunkVert(builder, corners[2], normal, texes[2], shades[2]);
+                builder.repeatVert(a);
+                makeChunkVert(builder, corners[3], normal, texes[3], shades[3]);
+                builder.repeatVert(b);
+            }
+        }
+        state.addItems(QuadCount);
+    }
+
+    state.setCounter("ns/quad", 1e9 * state.getSeconds() / (state.getIterations() * QuadCount));
+}
+
+BENCHMARK(MeshBuilder, ChunkQuadsPerVertex) {
+    benchChunkQuads(state, false);
+}
+
+BENCHMARK(MeshBuilder, ChunkQuadsBulk) {
+    benchChunkQuads(state, true);
+}
+
+// Likewise for text, as tesselate(Font) writes it, from vec4s of position
+// and texture coordinate or from separate arrays of each
+static void benchTextQuads(BenchmarkState &state, bool bulk) {
+    MeshBuilder builder;
+    while (state.keepRunning()) {
+        builder.reset(MeshFormat{2, 2});
+        if (bulk) {
+            builder.reserveQuads(QuadCount);
+        }
+        for (int i = 0; i < QuadCount; i++) {
+            const float xmin = i * 8.0f, xmax = xmin + 7;
+            const float ymin = 0, ymax = 12;
+            const float txmin = (i % 96) / 96.0f, txmax = txmin + 1 / 96.0f;
+            const float tymin = 0, tymax = 1;
+
+            if (bulk) {
+                builder.appendQuad(std::array<glm::vec2, 4>{{{xmin, ymin}, {xmax, ymin},
+                                                             {xmin, ymax}, {xmax, ymax}}},
+                                   std::array<glm::vec2, 4>{{{txmin, tymin}, {txmax, tymin},
+                                                             {txmin, tymax}, {txmax, tymax}}});
+            } else {
+                builder.makeVert(glm::vec4{xmin, ymin, txmin, tymin});
+                auto a = builder.makeVert(glm::vec4{xmax, ymin, txmax, tymin});
+                auto b = builder.makeVert(glm::vec4{xmin, ymax, txmin, tymax});
+                builder.repeatVert(a);
+                builder.makeVert(glm::vec4{xmax, ymax, txmax, tymax});
+                builder.repeatVert(b);
+            }
+        }
+        state.addItems(QuadCount);
+    }
+
+    state.setCounter("ns/quad", 1e9 * state.getSeconds() / (state.getIterations() * QuadCount));
+}
+
+BENCHMARK(MeshBuilder, TextQuadsPerVertex) {
+    benchTextQuads(state, false);
+}
+
+BENCHMARK(MeshBuilder, TextQuadsBulk) {
+    benchTextQuads(state, true);
+}
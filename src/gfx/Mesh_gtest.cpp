@@ -0,0 +1,45 @@
+#include "Mesh.h"
+#include <gtest/gtest.h>
+
+static void appendQuad(MeshBuilder &builder, float z) {
+    builder.appendQuad(std::array<glm::vec3, 4>{{{0, 0, z}, {1, 0, z},
+                                                  {0, 1, z}, {1, 1, z}}});
+}
+
+TEST(MeshBuilder, QuadsOnlyCountIndices) {
+    MeshBuilder builder{MeshFormat{3}};
+    appendQuad(builder, 0);
+    builder.startRange();
+    appendQuad(builder, 1);
+
+    EXPECT_TRUE(builder.isQuads());
+    EXPECT_EQ(12u, builder.getIndexCount());
+    EXPECT_TRUE(builder.getIndexBuffer().empty());
+    EXPECT_EQ(6u, builder.getRangeStart(1));
+    EXPECT_EQ(8*3*sizeof(float), builder.getBuffer().size());
+}
+
+TEST(MeshBuilder, OtherVerticesWriteOutQuadIndices) {
+    MeshBuilder builder{MeshFormat{3}};
+    appendQuad(builder, 0);
+    builder.makeVert(glm::vec3{0, 0, 2});
+    appendQuad(builder, 1);
+
+    EXPECT_FALSE(builder.isQuads());
+    const std::vector<MeshBuilder::Index> expected{0, 1, 2, 1, 3, 2, 4, 5, 6, 7, 6, 8, 7};
+    EXPECT_EQ(expected, builder.getIndexBuffer());
+    EXPECT_EQ(13u, builder.getIndexCount());
+}
+
+TEST(MeshBuilder, TakeDataKeepsQuads) {
+    MeshBuilder builder{MeshFormat{3}};
+    appendQuad(builder, 0);
+    MeshData data = builder.takeData(MeshData{});
+
+    EXPECT_TRUE(data.quads);
+    EXPECT_EQ(6u, data.index_count);
+    EXPECT_FALSE(data.empty());
+    EXPECT_TRUE(data.indices.empty());
+    EXPECT_TRUE(builder.isQuads());
+    EXPECT_EQ(0u, builder.getIndexCount());
+}
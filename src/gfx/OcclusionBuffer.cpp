@@ -0,0 +1,216 @@
+#include "gfx/OcclusionBuffer.h"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer() :
+    depth(Width*Height, 1.0f) { }
+
+void OcclusionBuffer::reset(const glm::mat4 &projview_) {
+    projview = projview_;
+    std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+bool OcclusionBuffer::projectBox(const glm::vec3 &min, const glm::vec3 &max,
+                                 std::array<ScreenPos, 8> &corners) const {
+    for (int i = 0; i < 8; i++) {
+        const glm::vec4 corner{i & 1 ? max.x : min.x,
+                               i & 2 ? max.y : min.y,
+                               i & 4 ? max.z : min.z,
+                               1};
+        const glm::vec4 clip = projview * corner;
+        // Clipping against the near plane isn't worth it here
+        if (clip.w < 1e-3f || clip.z < -clip.w) {
+            return false;
+        }
+
+        corners[i].x = (clip.x/clip.w*.5f + .5f) * Width;
+        corners[i].y = (clip.y/clip.w*.5f + .5f) * Height;
+        corners[i].z = clip.z/clip.w*.5f + .5f;
+    }
+    return true;
+}
+
+void OcclusionBuffer::drawOccluder(const glm::vec3 &min, const glm::vec3 &max) {
+    std::array<ScreenPos, 8> corners;
+    if (!projectBox(min, max, corners)) {
+        return;
+    }
+
+    // Corner indices of each face, counter-clockwise seen from outside
+    static const int faces[6][4] = {
+        {1, 3, 7, 5}, {0, 4, 6, 2}, // +x, -x
+        {2, 6, 7, 3}, {0, 1, 5, 4}, // +y, -y
+        {4, 5, 7, 6}, {0, 2, 3, 1}  // +z, -z
+    };
+    for (const auto &face : faces) {
+        drawTriangle(corners[face[0]], corners[face[1]], corners[face[2]]);
+        drawTriangle(corners[face[0]], corners[face[2]], corners[face[3]]);
+    }
+}
+
+void OcclusionBuffer::drawTriangle(const ScreenPos &a, const ScreenPos &b, const ScreenPos &c) {
+    // Twice the area, negative for back faces, which the front faces of
+    // the same box cover anyway
+    const float area = (b.x - a.x)*(c.y - a.y) - (b.y - a.y)*(c.x - a.x);
+    if (area <= 0) {
+        return;
+    }
+
+    const int xmin = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+    const int xmax = std::min(Width - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+    const int ymin = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+    const int ymax = std::min(Height - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+    if (xmin > xmax || ymin > ymax) {
+        return;
+    }
+
+    // Edge functions, positive inside, and depth, as planes over the
+    // screen, evaluated afresh at each pixel so that pixels don't depend
+    // on the ones before them
+    struct Plane {
+        float dx, dy, c;
+        float at(float x, float y) const { return dx*x + dy*y + c; }
+    };
+    auto edge = [](const ScreenPos &p, const ScreenPos &q) {
+        return Plane{p.y - q.y, q.x - p.x, p.x*q.y - p.y*q.x};
+    };
+    const Plane e0 = edge(b, c), e1 = edge(c, a), e2 = edge(a, b);
+    const Plane z{(e0.dx*a.z + e1.dx*b.z + e2.dx*c.z) / area,
+                  (e0.dy*a.z + e1.dy*b.z + e2.dy*c.z) / area,
+                  (e0.c*a.z + e1.c*b.z + e2.c*c.z) / area};
+
+#ifdef __SSE2__
+    const __m128 lanes = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 e0dx = _mm_set1_ps(e0.dx), e1dx = _mm_set1_ps(e1.dx);
+    const __m128 e2dx = _mm_set1_ps(e2.dx), zdx = _mm_set1_ps(z.dx);
+#endif
+    for (int y = ymin; y <= ymax; y++) {
+        const float py = y + .5f;
+        // Where each plane crosses x = 0 along the row
+        const float c0 = e0.at(0, py), c1 = e1.at(0, py), c2 = e2.at(0, py);
+        const float cz = z.at(0, py);
+        float *row = &depth[Width*y];
+
+        int x = xmin;
+#ifdef __SSE2__
+        // Four pixels at a time
+        const __m128 c0s = _mm_set1_ps(c0), c1s = _mm_set1_ps(c1);
+        const __m128 c2s = _mm_set1_ps(c2), czs = _mm_set1_ps(cz);
+        for (; x + 3 <= xmax; x += 4) {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+            const __m128 w0 = _mm_add_ps(_mm_mul_ps(e0dx, px), c0s);
+            const __m128 w1 = _mm_add_ps(_mm_mul_ps(e1dx, px), c1s);
+            const __m128 w2 = _mm_add_ps(_mm_mul_ps(e2dx, px), c2s);
+            const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero),
+                                                        _mm_cmpge_ps(w1, zero)),
+                                             _mm_cmpge_ps(w2, zero));
+            const __m128 old = _mm_loadu_ps(row + x);
+            const __m128 d = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(zdx, px), czs));
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, d),
+                                             _mm_andnot_ps(inside, old)));
+        }
+#endif
+        // The rest one at a time
+        for (; x <= xmax; x++) {
+            const float px = x + .5f;
+            if (e0.dx*px + c0 >= 0 && e1.dx*px + c1 >= 0 && e2.dx*px + c2 >= 0) {
+                row[x] = std::min(row[x], z.dx*px + cz);
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(const glm::vec3 &min, const glm::vec3 &max) const {
+    std::array<ScreenPos, 8> corners;
+    if (!projectBox(min, max, corners)) {
+        return true;
+    }
+
+    // Test every pixel the box's screen rectangle touches against the
+    // box's nearest point
+    float xmin = corners[0].x, xmax = xmin, ymin = corners[0].y, ymax = ymin;
+    float zmin = corners[0].z;
+    for (const ScreenPos &corner : corners) {
+        xmin = std::min(xmin, corner.x);
+        xmax = std::max(xmax, corner.x);
+        ymin = std::min(ymin, corner.y);
+        ymax = std::max(ymax, corner.y);
+        zmin = std::min(zmin, corner.z);
+    }
+
+    // Nothing was drawn past the edges, so a box reaching past them
+    // could be in view through the gap there
+    if (xmin < 0 || xmax >= Width || ymin < 0 || ymax >= Height) {
+        return true;
+    }
+
+    const int x0 = static_cast<int>(std::floor(xmin));
+    const int x1 = static_cast<int>(std::floor(xmax));
+    const int y0 = static_cast<int>(std::floor(ymin));
+    const int y1 = static_cast<int>(std::floor(ymax));
+
+    for (int y = y0; y <= y1; y++) {
+        const float *row = &depth[Width*y];
+        for (int x = x0; x <= x1; x++) {
+            if (row[x] >= zmin) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+ChunkOccluder ChunkOccluder::compute(const ChunkFaceMasks::Mask &opaque) {
+    using Row = ChunkFaceMasks::Row;
+
+    // The z range opaque all the way across each column
+    std::array<std::pair<int, int>, Columns*Columns> ranges;
+    for (int cx = 0; cx < Columns; cx++) {
+        for (int cy = 0; cy < Columns; cy++) {
+            Row common = ~Row{0};
+            for (int x = cx*ColumnSize; x < (cx+1)*ColumnSize; x++) {
+                for (int y = cy*ColumnSize; y < (cy+1)*ColumnSize; y++) {
+                    common &= opaque[ChunkFaceMasks::rowIndex(x, y)];
+                }
+            }
+
+            // Longest run of set bits
+            std::pair<int, int> best{0, 0};
+            while (common) {
+                const int start = __builtin_ctz(common);
+                const Row rest = ~(common >> start);
+                const int end = rest ? start + __builtin_ctz(rest) : Chunk::ZSize;
+                if (end - start > best.second - best.first) {
+                    best = {start, end};
+                }
+                common = end >= Chunk::ZSize ? 0 : common & (~Row{0} << end);
+            }
+            ranges[cy + Columns*cx] = best;
+        }
+    }
+
+    // Merge columns with the same range along x, which is most of them on
+    // flat ground and underground
+    ChunkOccluder occluder;
+    for (int cy = 0; cy < Columns; cy++) {
+        int cx = 0;
+        while (cx < Columns) {
+            const auto range = ranges[cy + Columns*cx];
+            int end = cx + 1;
+            while (end < Columns && ranges[cy + Columns*end] == range) {
+                end++;
+            }
+            if (range.second > range.first) {
+                occluder.boxes.push_back(Box{
+                    glm::ivec3{cx*ColumnSize, cy*ColumnSize, range.first},
+                    glm::ivec3{end*ColumnSize, (cy+1)*ColumnSize, range.second}});
+            }
+            cx = end;
+        }
+    }
+    return occluder;
+}
@@ -0,0 +1,76 @@
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include "gfx/ChunkFaceMasks.h"
+
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// A small depth buffer drawn on the CPU, with boxes of solid ground
+// close to the camera, so that boxes of geometry further away can be
+// tested against it before being drawn. Skips occluders crossing the
+// near plane, and counts boxes reaching past the buffer's edges as
+// visible, so it can miss some occlusion. A box found hidden is behind
+// the occluders along every line of sight from the eye, whichever way
+// the eye faces, save that occluders only cover the pixels whose
+// centres they cover, so their edges are only right to within a pixel.
+class OcclusionBuffer {
+public:
+    static constexpr int Width = 256;
+    static constexpr int Height = 128;
+
+    OcclusionBuffer();
+
+    // Clears the depth buffer, for drawing with projview
+    void reset(const glm::mat4 &projview);
+
+    void drawOccluder(const glm::vec3 &min, const glm::vec3 &max);
+    // False if the box is completely behind the occluders drawn so far,
+    // and on the buffer
+    bool isVisible(const glm::vec3 &min, const glm::vec3 &max) const;
+
+    // In [0, 1] like the GL depth buffer, 1 where nothing was drawn
+    float getDepth(int x, int y) const { return depth[x + Width*y]; }
+
+private:
+    glm::mat4 projview;
+    std::vector<float> depth;
+
+    struct ScreenPos {
+        float x;
+        float y;
+        float z;
+    };
+
+    // False if any corner is too close to, or behind, the camera
+    bool projectBox(const glm::vec3 &min, const glm::vec3 &max,
+                    std::array<ScreenPos, 8> &corners) const;
+    void drawTriangle(const ScreenPos &a, const ScreenPos &b, const ScreenPos &c);
+};
+
+// The largest runs of opaque blocks through a chunk's columns, as boxes
+// for OcclusionBuffer::drawOccluder. Computed from the same opaque mask
+// as ChunkVisibility.
+class ChunkOccluder {
+public:
+    static constexpr int ColumnSize = 8;
+    static constexpr int Columns = Chunk::XSize / ColumnSize;
+
+    struct Box {
+        glm::ivec3 min;
+        glm::ivec3 max;
+    };
+
+    ChunkOccluder() { }
+    static ChunkOccluder compute(const ChunkFaceMasks::Mask &opaque);
+
+    // In blocks, relative to the chunk
+    const std::vector<Box> &getBoxes() const { return boxes; }
+
+private:
+    std::vector<Box> boxes;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "OcclusionBuffer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <gtest/gtest.h>
+
+// Looking down -z from the origin
+static OcclusionBuffer makeBuffer() {
+    OcclusionBuffer buffer;
+    buffer.reset(glm::perspective(45.0f, 2.0f, 1.0f, 100.0f));
+    return buffer;
+}
+
+TEST(OcclusionBuffer, EmptyHidesNothing) {
+    auto buffer = makeBuffer();
+    EXPECT_TRUE(buffer.isVisible(glm::vec3{-1, -1, -50}, glm::vec3{1, 1, -48}));
+}
+
+TEST(OcclusionBuffer, WallHidesBoxBehind) {
+    auto buffer = makeBuffer();
+    buffer.drawOccluder(glm::vec3{-20, -20, -11}, glm::vec3{20, 20, -10});
+    EXPECT_FALSE(buffer.isVisible(glm::vec3{-1, -1, -50}, glm::vec3{1, 1, -48}));
+    EXPECT_TRUE(buffer.isVisible(glm::vec3{-1, -1, -8}, glm::vec3{1, 1, -6}));
+    // Pokes through the wall
+    EXPECT_TRUE(buffer.isVisible(glm::vec3{-1, -1, -50}, glm::vec3{1, 1, -9}));
+}
+
+TEST(OcclusionBuffer, BoxPeekingPastEdgeIsVisible) {
+    auto buffer = makeBuffer();
+    buffer.drawOccluder(glm::vec3{-20, -20, -11}, glm::vec3{0, 20, -10});
+    EXPECT_FALSE(buffer.isVisible(glm::vec3{-10, -1, -50}, glm::vec3{-8, 1, -48}));
+    EXPECT_TRUE(buffer.isVisible(glm::vec3{-2, -1, -50}, glm::vec3{4, 1, -48}));
+}
+
+TEST(OcclusionBuffer, BoxPastEdgeIsVisible) {
+    auto buffer = makeBuffer();
+    buffer.drawOccluder(glm::vec3{-200, -200, -11}, glm::vec3{200, 200, -10});
+    EXPECT_FALSE(buffer.isVisible(glm::vec3{30, -1, -50}, glm::vec3{35, 1, -48}));
+    // Nothing was drawn past the right edge to hide the rest of it
+    EXPECT_TRUE(buffer.isVisible(glm::vec3{30, -1, -50}, glm::vec3{50, 1, -48}));
+}
+
+TEST(OcclusionBuffer, DrawsFrontFaces) {
+    auto buffer = makeBuffer();
+    buffer.drawOccluder(glm::vec3{-20, -20, -30}, glm::vec3{20, 20, -10});
+    // The box's front face is at z = -10, so a box just behind it is
+    // hidden
+    EXPECT_FALSE(buffer.isVisible(glm::vec3{-1, -1, -13}, glm::vec3{1, 1, -12}));
+}
+
+TEST(OcclusionBuffer, OccluderAcrossNearPlaneIsSkipped) {
+    auto buffer = makeBuffer();
+    buffer.drawOccluder(glm::vec3{-20, -20, -11}, glm::vec3{20, 20, 5});
+    EXPECT_TRUE(buffer.isVisible(glm::vec3{-1, -1, -50}, glm::vec3{1, 1, -48}));
+}
+
+static void setBlock(ChunkFaceMasks::Mask &mask, int x, int y, int z) {
+    mask[ChunkFaceMasks::rowIndex(x, y)] |= ChunkFaceMasks::bit(z);
+}
+
+TEST(ChunkOccluder, SolidChunkIsOneBox) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(~ChunkFaceMasks::Row{0});
+    auto boxes = ChunkOccluder::compute(opaque).getBoxes();
+    // One box per row of columns
+    ASSERT_EQ(4u, boxes.size());
+    EXPECT_EQ(glm::ivec3(0, 0, 0), boxes[0].min);
+    EXPECT_EQ(glm::ivec3(32, 8, 32), boxes[0].max);
+}
+
+TEST(ChunkOccluder, TakesLongestCommonRun) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(0);
+    for (int x = 0; x < Chunk::XSize; x++) {
+        for (int y = 0; y < Chunk::YSize; y++) {
+            for (int z = 0; z < 4; z++) {
+                setBlock(opaque, x, y, z);
+            }
+            for (int z = 10; z < 20; z++) {
+                setBlock(opaque, x, y, z);
+            }
+        }
+    }
+    // A hole through one column breaks its run
+    opaque[ChunkFaceMasks::rowIndex(3, 3)] &= ~ChunkFaceMasks::bit(15);
+
+    auto boxes = ChunkOccluder::compute(opaque).getBoxes();
+    ASSERT_EQ(5u, boxes.size());
+    EXPECT_EQ(glm::ivec3(0, 0, 10), boxes[0].min);
+    EXPECT_EQ(glm::ivec3(8, 8, 15), boxes[0].max);
+    EXPECT_EQ(glm::ivec3(8, 0, 10), boxes[1].min);
+    EXPECT_EQ(glm::ivec3(32, 8, 20), boxes[1].max);
+}
+
+TEST(ChunkOccluder, EmptyChunkHasNoBoxes) {
+    ChunkFaceMasks::Mask opaque;
+    opaque.fill(0);
+    EXPECT_TRUE(ChunkOccluder::compute(opaque).getBoxes().empty());
+}
@@ -1,4 +1,5 @@
 #include "PlantBlockVisual.h"
+#include "gfx/ChunkVertex.h"
 
 PlantBlockVisual::PlantBlockVisual(const PlantBlockVisualInfo &info,
                                    TextureArrayBuilder &block_tex_builder) {
@@ -7,54 +8,44 @@ PlantBlockVisual::PlantBlockVisual(const PlantBlockVisualInfo &info,
 
 void PlantBlockVisual::tesselate(MeshBuilder &builder,
                                  const BlockVisualRegistry &visuals,
-                                 const Chunk &chunk,
+                                 const ChunkNeighborhood &neighborhood,
                                  const ChunkIndex &pos,
                                  const Block &block) const {
-    const glm::vec3 bfl{pos.getVec()};
-    const glm::vec3 bfr = bfl + glm::vec3{1, 0, 0};
-    const glm::vec3 bbl = bfl + glm::vec3{0, 1, 0};
-    const glm::vec3 bbr = bfl + glm::vec3{1, 1, 0};
-    const glm::vec3 tfl = bfl + glm::vec3{0, 0, 1};
-    const glm::vec3 tfr = bfl + glm::vec3{1, 0, 1};
-    const glm::vec3 tbl = bfl + glm::vec3{0, 1, 1};
-    const glm::vec3 tbr = bfl + glm::vec3{1, 1, 1};
+    tesselateAt(builder, pos.getVec(), tex);
+}
 
-    const glm::vec3 tex_bl{0, 0, tex};
-    const glm::vec3 tex_br{1, 0, tex};
-    const glm::vec3 tex_tl{0, 1, tex};
-    const glm::vec3 tex_tr{1, 1, tex};
+void PlantBlockVisual::buildInstanceMesh(MeshBuilder &builder) {
+    builder.reset(chunkMeshFormat());
+    tesselateAt(builder, glm::ivec3{0, 0, 0}, 0);
+}
 
-    auto normal = glm::normalize(glm::vec3{1, -1, 0});
-    MeshBuilder::Index a;
-    MeshBuilder::Index b;
-    
-    builder.makeVert(bfl, normal, tex_bl);
-    a = builder.makeVert(bbr, normal, tex_br);
-    b = builder.makeVert(tfl, normal, tex_tl);
-    builder.repeatVert(a);
-    builder.makeVert(tbr, normal, tex_tr);
-    builder.repeatVert(b);
+void PlantBlockVisual::tesselateAt(MeshBuilder &builder, const glm::ivec3 &pos, int layer) {
+    const glm::ivec3 bfl = pos;
+    const glm::ivec3 bfr = bfl + glm::ivec3{1, 0, 0};
+    const glm::ivec3 bbl = bfl + glm::ivec3{0, 1, 0};
+    const glm::ivec3 bbr = bfl + glm::ivec3{1, 1, 0};
+    const glm::ivec3 tfl = bfl + glm::ivec3{0, 0, 1};
+    const glm::ivec3 tfr = bfl + glm::ivec3{1, 0, 1};
+    const glm::ivec3 tbl = bfl + glm::ivec3{0, 1, 1};
+    const glm::ivec3 tbr = bfl + glm::ivec3{1, 1, 1};
 
-    a = builder.makeVert(bbr, -normal, tex_bl);
-    builder.makeVert(bfl, -normal, tex_br);
-    b = builder.makeVert(tfl, -normal, tex_tr);
-    builder.repeatVert(a);
-    builder.repeatVert(b);
-    builder.makeVert(tbr, -normal, tex_tl);
+    const glm::ivec3 tex_bl{0, 0, layer};
+    const glm::ivec3 tex_br{1, 0, layer};
+    const glm::ivec3 tex_tl{0, 1, layer};
+    const glm::ivec3 tex_tr{1, 1, layer};
 
-    normal = glm::normalize(glm::vec3{-1, -1, 0});
-    
-    builder.makeVert(bbl, normal, tex_bl);
-    a = builder.makeVert(bfr, normal, tex_br);
-    b = builder.makeVert(tbl, normal, tex_tl);
-    builder.repeatVert(a);
-    builder.makeVert(tfr, normal, tex_tr);
-    builder.repeatVert(b);
+    // Plants aren't occluded, just lit by the sun
+    auto shades = [](ChunkNormal normal) {
+        const uint8_t shade = chunkShade(normal);
+        return std::array<uint8_t, 4>{{shade, shade, shade, shade}};
+    };
 
-    a = builder.makeVert(bfr, -normal, tex_bl);
-    builder.makeVert(bbl, -normal, tex_br);
-    b = builder.makeVert(tbl, -normal, tex_tr);
-    builder.repeatVert(a);
-    builder.repeatVert(b);
-    builder.makeVert(tfr, -normal, tex_tl);
+    makeChunkQuad(builder, {{bfl, bbr, tfl, tbr}}, ChunkNormal::PLANT_A,
+                  {{tex_bl, tex_br, tex_tl, tex_tr}}, shades(ChunkNormal::PLANT_A));
+    makeChunkQuad(builder, {{bfl, tfl, bbr, tbr}}, ChunkNormal::PLANT_A_BACK,
+                  {{tex_br, tex_tr, tex_bl, tex_tl}}, shades(ChunkNormal::PLANT_A_BACK));
+    makeChunkQuad(builder, {{bbl, bfr, tbl, tfr}}, ChunkNormal::PLANT_B,
+                  {{tex_bl, tex_br, tex_tl, tex_tr}}, shades(ChunkNormal::PLANT_B));
+    makeChunkQuad(builder, {{bbl, tbl, bfr, tfr}}, ChunkNormal::PLANT_B_BACK,
+                  {{tex_br, tex_tr, tex_bl, tex_tl}}, shades(ChunkNormal::PLANT_B_BACK));
 }
@@ -16,11 +16,20 @@ public:
 
     virtual void tesselate(MeshBuilder &builder,
                            const BlockVisualRegistry &visuals,
-                           const Chunk &chunk,
+                           const ChunkNeighborhood &neighborhood,
                            const ChunkIndex &pos,
                            const Block &block) const;
 
     virtual bool isTransparent() const { return true; }
+    virtual const unsigned int *getPlantTex() const { return &tex; }
+
+    // The crossed quads of a plant at the origin with texture layer 0,
+    // which PlantInstances move and retexture
+    static void buildInstanceMesh(MeshBuilder &builder);
+    // The crossed quads of a plant at pos, for BlockVisualRegistry to
+    // mesh plants in a batch
+    static void tesselateAt(MeshBuilder &builder, const glm::ivec3 &pos, int layer);
+
 private:
     unsigned int tex;
 };
@@ -0,0 +1,55 @@
+#include "gfx/QuadIndexBuffer.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+constexpr size_t QuadIndexBuffer::MaxNarrowQuads;
+
+QuadIndexBuffer &QuadIndexBuffer::get() {
+    static QuadIndexBuffer *buffer = new QuadIndexBuffer;
+    return *buffer;
+}
+
+template <typename Index>
+static std::vector<Index> makeQuadIndices(size_t quad_count) {
+    std::vector<Index> indices(6*quad_count);
+    for (size_t quad = 0; quad < quad_count; quad++) {
+        const Index first = static_cast<Index>(4*quad);
+        Index *out = &indices[6*quad];
+        out[0] = first;
+        out[1] = out[3] = first + 1;
+        out[2] = out[5] = first + 2;
+        out[4] = first + 3;
+    }
+    return indices;
+}
+
+void QuadIndexBuffer::reserve(size_t count) {
+    if (count <= quad_count) {
+        return;
+    }
+
+    // Double as meshes grow, but only go wide when a mesh needs it
+    size_t newcount = std::max<size_t>({2*quad_count, count, 1024});
+    if (count <= MaxNarrowQuads) {
+        newcount = std::min(newcount, MaxNarrowQuads);
+    } else {
+        wide = true;
+    }
+
+    // Uploaded through the array target, since binding an element buffer
+    // would change whichever vertex array is bound
+    if (wide) {
+        auto indices = makeQuadIndices<uint32_t>(newcount);
+        buf.setData(&indices.front(), indices.size() * sizeof(uint32_t), Buffer::ARRAY);
+    } else {
+        auto indices = makeQuadIndices<uint16_t>(newcount);
+        buf.setData(&indices.front(), indices.size() * sizeof(uint16_t), Buffer::ARRAY);
+    }
+    quad_count = newcount;
+}
+
+unsigned int QuadIndexBuffer::getType() const {
+    return wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+}
@@ -0,0 +1,44 @@
+#ifndef QUADINDEXBUFFER_H
+#define QUADINDEXBUFFER_H
+
+#include "gfx/Buffer.h"
+
+#include <cstddef>
+
+// The indices of a run of quads, as MeshBuilder::appendQuad lays them
+// out: four vertices a quad, drawn as 0 1 2, 1 3 2. Quad meshes all draw
+// with this one buffer, rather than each uploading their own indices.
+// Indices are 16 bit for as long as every mesh fits, and 32 bit from the
+// first mesh over 65536 vertices on.
+class QuadIndexBuffer {
+public:
+    // The one buffer, made on first use. It's never destroyed, as there
+    // may be no GL context left by then.
+    static QuadIndexBuffer &get();
+
+    QuadIndexBuffer(const QuadIndexBuffer &) = delete;
+    QuadIndexBuffer &operator=(const QuadIndexBuffer &) = delete;
+
+    // Grows the buffer to cover meshes of up to quad_count quads. The
+    // buffer keeps its ID, so vertex arrays pointing at it stay valid,
+    // but draws must ask for the type again afterwards.
+    void reserve(size_t quad_count);
+
+    const Buffer &getBuffer() const { return buf; }
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    unsigned int getType() const;
+    size_t getIndexSize() const { return wide ? 4 : 2; }
+    size_t getQuadCount() const { return quad_count; }
+    size_t getBytes() const { return buf.getSize(); }
+
+    static constexpr size_t MaxNarrowQuads = 65536 / 4;
+
+private:
+    QuadIndexBuffer() { }
+
+    Buffer buf;
+    size_t quad_count = 0;
+    bool wide = false;
+};
+
+#endif
@@ -12,8 +12,20 @@ ShaderError::ShaderError(const std::string &msg) : std::runtime_error(msg) { }
 
 static std::string readfile(const std::string &filename);
 
-Shader::Shader(Type type, const std::string &filename) {
+Shader::Shader(Type type, const std::string &filename,
+               const std::vector<std::string> &defines) {
     std::string file = readfile(filename);
+    if (!defines.empty()) {
+        std::stringstream header;
+        for (const auto &define : defines) {
+            header << "#define " << define << '\n';
+        }
+        // Keep line numbers in compile errors matching the file
+        header << "#line 2\n";
+        auto version_end = file.find('\n');
+        file.insert(version_end == std::string::npos ? file.size() : version_end + 1,
+                    header.str());
+    }
 
     id = glCreateShader(type == Type::VERTEX ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
     const char *filecstr = file.c_str();
@@ -71,6 +83,12 @@ void ShaderProgram::setUniform(const std::string &name, const glm::mat4 &mat) {
     glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
+void ShaderProgram::setUniform(const std::string &name, int val) {
+    auto loc = glGetUniformLocation(id, name.c_str());
+    glUseProgram(id);
+    glUniform1i(loc, val);
+}
+
 void ShaderProgram::deleteId() {
     glDeleteShader(id);
 }
@@ -8,6 +8,8 @@
 #include <initializer_list>
 #include <functional>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 class ShaderError : public std::runtime_error {
 public:
@@ -20,7 +22,12 @@ public:
     enum class Type { VERTEX, FRAGMENT };
 
     Shader() { }
-    Shader(Type type, const std::string &filename);
+    Shader(Type type, const std::string &filename) :
+        Shader(type, filename, {}) { }
+    // Compiles a variant of the shader with each of defines #defined,
+    // after the #version line
+    Shader(Type type, const std::string &filename,
+           const std::vector<std::string> &defines);
 
 private:
     void deleteId();
@@ -33,6 +40,8 @@ public:
     ShaderProgram(const std::initializer_list<std::reference_wrapper<const Shader>> &shaders);
 
     void setUniform(const std::string &name, const glm::mat4 &mat);
+    // Also for samplers, given their texture unit
+    void setUniform(const std::string &name, int val);
 
 private:
     void deleteId();
@@ -15,14 +15,19 @@ class SimpleBlockVisual : public BlockVisual {
 public:
     SimpleBlockVisual(const SimpleBlockVisualInfo &info,
                       TextureArrayBuilder &block_tex_builder);
+    // With texture layers already in the block texture
+    explicit SimpleBlockVisual(const FaceMap<unsigned int> &face_texes) :
+        face_texes(face_texes) { }
 
     virtual void tesselate(MeshBuilder &builder,
                            const BlockVisualRegistry &visuals,
-                           const Chunk &chunk,
+                           const ChunkNeighborhood &neighborhood,
                            const ChunkIndex &pos,
                            const Block &block) const;
 
     virtual bool isTransparent() const { return false; }
+    virtual const FaceMap<unsigned int> *getCubeFaceTexes() const { return &face_texes; }
+
 private:
     FaceMap<unsigned int> face_texes;
 };
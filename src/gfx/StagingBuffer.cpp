@@ -0,0 +1,83 @@
+#include "gfx/StagingBuffer.h"
+#include <GL/glew.h>
+#include <algorithm>
+
+// Keeps ranges aligned for any vertex attribute or index type
+static constexpr size_t Alignment = 16;
+
+bool StagingBuffer::isSupported() {
+    return GLEW_ARB_buffer_storage;
+}
+
+StagingBuffer::StagingBuffer(size_t size) :
+    ranges(size)
+{
+    mapping = static_cast<uint8_t *>(buf.mapPersistent(size));
+}
+
+StagingBuffer::~StagingBuffer() {
+    for (const Batch &batch : batches) {
+        glDeleteSync(static_cast<GLsync>(batch.fence));
+    }
+}
+
+bool StagingBuffer::allocate(size_t size, Range &range) {
+    size = (size + Alignment - 1) / Alignment * Alignment;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto offset = ranges.allocate(size);
+    if (!offset) {
+        return false;
+    }
+    range = Range{*offset, size};
+    return true;
+}
+
+void StagingBuffer::free(const Range &range) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ranges.free(range.offset, range.size);
+}
+
+void StagingBuffer::copy(const Range &range, size_t offset, size_t len,
+                         const Buffer &dest, size_t dest_offset) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buf.getID());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dest.getID());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        range.offset + offset, dest_offset, len);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StagingBuffer::release(const Range &range) {
+    released.push_back(range);
+}
+
+void StagingBuffer::retire() {
+    if (!released.empty()) {
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        batches.push_back(Batch{fence, std::move(released)});
+        released.clear();
+    }
+
+    // Fences signal in order, so stop at the first that hasn't
+    auto done = batches.begin();
+    for (; done != batches.end(); ++done) {
+        GLsync fence = static_cast<GLsync>(done->fence);
+        const GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(fence);
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Range &range : done->ranges) {
+            ranges.free(range.offset, range.size);
+        }
+    }
+    batches.erase(batches.begin(), done);
+}
+
+size_t StagingBuffer::getUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ranges.getUsed();
+}
@@ -0,0 +1,65 @@
+#ifndef STAGINGBUFFER_H
+#define STAGINGBUFFER_H
+
+#include "gfx/Buffer.h"
+#include "util/RangeAllocator.h"
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// A persistently mapped buffer that worker threads write data into, to
+// be copied on into other buffers by the GPU, so that the main thread
+// never copies the data itself. Ranges are only handed out again once
+// the GPU has finished copying out of them.
+class StagingBuffer {
+public:
+    // Needs GL_ARB_buffer_storage
+    static bool isSupported();
+
+    explicit StagingBuffer(size_t size);
+    StagingBuffer(const StagingBuffer &) = delete;
+    StagingBuffer &operator=(const StagingBuffer &) = delete;
+    ~StagingBuffer();
+
+    struct Range {
+        size_t offset;
+        size_t size;
+    };
+
+    // Thread safe. False if there isn't room, in which case the data
+    // needs uploading some other way.
+    bool allocate(size_t size, Range &range);
+    // Thread safe, for ranges that were never copied from
+    void free(const Range &range);
+    uint8_t *getPointer(const Range &range) const { return mapping + range.offset; }
+
+    // Queues a GPU copy of len bytes from offset into range, to
+    // dest_offset in dest
+    void copy(const Range &range, size_t offset, size_t len,
+              const Buffer &dest, size_t dest_offset);
+    // Frees range once the copies queued so far are done
+    void release(const Range &range);
+    // Fences off the ranges released since the last call, and frees the
+    // ones whose copies are done. Call about once a frame.
+    void retire();
+
+    size_t getSize() const { return buf.getSize(); }
+    size_t getUsed() const;
+
+private:
+    Buffer buf;
+    uint8_t *mapping;
+
+    mutable std::mutex mutex;
+    RangeAllocator ranges;
+
+    struct Batch {
+        void *fence; // GLsync
+        std::vector<Range> ranges;
+    };
+    std::vector<Range> released;
+    std::vector<Batch> batches;
+};
+
+#endif
@@ -55,6 +55,17 @@ void ArrayTexture::bind(unsigned int id) const {
     glBindTexture(GL_TEXTURE_2D_ARRAY, id);
 }
 
+void BufferTexture::setBuffer(const Buffer &buf, unsigned int format) {
+    genId();
+    bind(0);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buf.getID());
+}
+
+void BufferTexture::bind(unsigned int pos) const {
+    glActiveTexture(GL_TEXTURE0 + pos);
+    glBindTexture(GL_TEXTURE_BUFFER, id);
+}
+
 Sampler::Sampler(Filter filter, bool wrap) {
     GLuint tmp;
     glGenSamplers(1, &tmp);
@@ -2,6 +2,7 @@
 #define TEXTURE_H
 
 #include "gfx/Image.h"
+#include "gfx/Buffer.h"
 #include "util/IDBase.h"
 
 #include <GL/glew.h>
@@ -53,6 +54,20 @@ private:
     unsigned int layers;
 };
 
+// A view of a buffer's contents as a one dimensional texture of texels
+// in a sized internal format (GL_RG32UI, ...), for shaders to fetch from
+// by index
+class BufferTexture : public BaseTexture {
+public:
+    BufferTexture() { }
+    BufferTexture(const Buffer &buf, unsigned int format) { setBuffer(buf, format); }
+
+    // Must be called again whenever buf is reallocated
+    void setBuffer(const Buffer &buf, unsigned int format);
+
+    void bind(unsigned int pos) const;
+};
+
 class Sampler : public IDBase<Sampler> {
     friend class IDBase<Sampler>;
 public:
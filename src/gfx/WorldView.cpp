@@ -1,22 +1,44 @@
 #include "gfx/WorldView.h"
+#include "gfx/Frustum.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+constexpr float WorldView::OcclusionSlack;
 
 WorldView::WorldView(ThreadManager &tm,
                      const World &world,
                      Sampler sampler,
-                     ShaderProgram prgm,
+                     ShaderProgram opaque_prgm,
+                     ShaderProgram cutout_prgm,
+                     ShaderProgram plant_prgm,
                      BlockVisualRegistry blockvisuals) :
+    tm(tm),
     world(world),
     sampler(std::move(sampler)),
-    prgm(std::move(prgm)),
-    chunkmeshes(tm, std::move(blockvisuals))
+    opaque_prgm(std::move(opaque_prgm)),
+    cutout_prgm(std::move(cutout_prgm)),
+    plant_prgm(std::move(plant_prgm)),
+    chunkmeshes(tm, std::move(blockvisuals), world.getBlockTypes()),
+    occlusion_times(120)
 {
+    this->opaque_prgm.setUniform("faces", static_cast<int>(FaceTextureUnit));
+    this->cutout_prgm.setUniform("faces", static_cast<int>(FaceTextureUnit));
 }
 
 void WorldView::render(Window &window) {
-    prgm.setUniform("perspective", getProjection(window).getMatrix());
+    const glm::mat4 proj = getProjection(window).getMatrix();
+    opaque_prgm.setUniform("perspective", proj);
+    cutout_prgm.setUniform("perspective", proj);
+    plant_prgm.setUniform("perspective", proj);
 
+    if (chunkmeshes.getGeometry() == ChunkGeometry::FACES) {
+        chunkmeshes.getArena().getVertexTexture().bind(FaceTextureUnit);
+    }
     chunkmeshes.getBlockTex().bind(0);
     sampler.bind(0);
 
@@ -25,27 +47,302 @@ void WorldView::render(Window &window) {
     glm::ivec3 centerchunkpos =
         ChunkGrid::posToChunkBlock(glm::ivec3{camera.pos}).first;
 
-    for (int x = centerchunkpos.x - 3; x <= centerchunkpos.x + 3; x++) {
-        for (int y = centerchunkpos.y - 3; y <= centerchunkpos.y + 3; y++) {
-            for (int z = centerchunkpos.z - 3; z <= centerchunkpos.z + 3; z++) {
-                glm::ivec3 chunkpos{x, y, z};
-                auto chunkptr = world.getChunks().getChunk(chunkpos);
-                auto meshptr = chunkmeshes.updateMesh(chunkpos, chunkptr);
-                if (!meshptr) {
+    glm::mat4 model{1};
+    model = glm::translate(model, glm::vec3{32*centerchunkpos});
+    opaque_prgm.setUniform("modelview", view*model);
+    cutout_prgm.setUniform("modelview", view*model);
+    plant_prgm.setUniform("modelview", view*model);
+
+    // Relative to the centre chunk, like the offsets below
+    const Frustum frustum{proj*view*model};
+    const glm::vec3 chunksize{Chunk::XSize, Chunk::YSize, Chunk::ZSize};
+
+    // First find the meshes and occluders already in the view distance
+    const int radius = view_distance.radius;
+    const int vertical_radius = view_distance.vertical_radius;
+    const glm::ivec3 extent{2*radius + 1, 2*radius + 1, 2*vertical_radius + 1};
+    struct Slot {
+        const ChunkMeshManager::SectionMeshes *sections = nullptr;
+        bool in_frustum = false;
+        bool reached = false;
+    };
+    std::vector<Slot> slots(extent.x*extent.y*extent.z);
+    auto getSlot = [&](const glm::ivec3 &offset) -> Slot * {
+        const glm::ivec3 i = offset + glm::ivec3{radius, radius, vertical_radius};
+        if (i.x < 0 || i.x >= extent.x || i.y < 0 || i.y >= extent.y ||
+            i.z < 0 || i.z >= extent.z) {
+            return nullptr;
+        }
+        return &slots[i.z + extent.z*(i.y + extent.y*i.x)];
+    };
+
+    // Leave out neighbours at other levels of detail, so that the faces
+    // against them are kept as skirts over any seams
+    auto getNeighborhood = [&](const glm::ivec3 &offset, int lod) {
+        auto neighborhood = world.getChunks().getNeighborhood(centerchunkpos + offset);
+        for (Face face : all_faces) {
+            if (view_distance.getLOD(adjacentPos(offset, face)) != lod) {
+                neighborhood.neighbors[face] = nullptr;
+            }
+        }
+        for (int i = 0; i < ChunkNeighborhood::DiagonalCount; i++) {
+            if (view_distance.getLOD(offset + ChunkNeighborhood::diagonal_offsets[i]) != lod) {
+                neighborhood.diagonals[i] = nullptr;
+            }
+        }
+        return neighborhood;
+    };
+
+    // Chunks close by draw their solid ground into the occlusion buffer
+    std::vector<OcclusionBox> occluders;
+    auto distance = [](const glm::ivec3 &offset) {
+        return std::max(std::max(std::abs(offset.x), std::abs(offset.y)),
+                        std::abs(offset.z));
+    };
+
+    long culled = 0;
+    for (int x = -radius; x <= radius; x++) {
+        for (int y = -radius; y <= radius; y++) {
+            for (int z = -vertical_radius; z <= vertical_radius; z++) {
+                const glm::ivec3 offset{x, y, z};
+                const glm::ivec3 chunkpos = centerchunkpos + offset;
+
+                // Meshes are only brought up to date, and kept from
+                // eviction, once the walk below reaches them
+                Slot &slot = *getSlot(offset);
+                slot.sections = chunkmeshes.getMesh(chunkpos);
+                const glm::vec3 min{32*offset};
+                slot.in_frustum = frustum.intersects(min, min + chunksize);
+                if (slot.sections && !slot.in_frustum) {
+                    culled++;
+                }
+
+                const ChunkOccluder *occluder = chunkmeshes.getOccluder(chunkpos);
+                if (occluder && slot.in_frustum &&
+                    distance(offset) <= view_distance.occluder_radius) {
+                    for (const auto &box : occluder->getBoxes()) {
+                        occluders.push_back(OcclusionBox{min + glm::vec3{box.min},
+                                                         min + glm::vec3{box.max}});
+                    }
+                }
+            }
+        }
+    }
+
+    // Then walk out from the camera's chunk, only passing through a chunk
+    // between faces that can see each other, and never doubling back
+    // towards the camera. Chunks walled off by solid ground are never
+    // reached, and not drawn. Chunks without meshes yet see through
+    // everywhere, so the walk reaches past them to the chunks they
+    // might reveal.
+    struct Step {
+        glm::ivec3 offset;
+        Face entered;
+        unsigned int directions;
+    };
+    std::vector<Step> queue;
+    if (Slot *start = getSlot(glm::ivec3{0, 0, 0})) {
+        start->reached = true;
+        queue.push_back(Step{glm::ivec3{0, 0, 0}, Face::TOP, 0});
+    }
+
+    const glm::vec3 eye = camera.pos - glm::vec3{32*centerchunkpos};
+    long drawn = 0, hidden = 0;
+    const bool occlusion_valid =
+        glm::length(camera.pos - occlusion_eye) <= OcclusionSlack;
+    std::vector<glm::ivec3> candidates;
+    std::vector<glm::ivec3> visible;
+
+    for (unsigned int i = 0; i < queue.size(); i++) {
+        const Step step = queue[i];
+        Slot &slot = *getSlot(step.offset);
+        const bool start = i == 0;
+
+        const glm::ivec3 chunkpos = centerchunkpos + step.offset;
+        const int lod = view_distance.getLOD(step.offset);
+        slot.sections = chunkmeshes.updateMesh(chunkpos, getNeighborhood(step.offset, lod), lod);
+
+        if (slot.sections && distance(step.offset) > view_distance.test_radius) {
+            candidates.push_back(step.offset);
+        }
+
+        if (slot.sections && occlusion_valid && hidden_chunks.count(chunkpos)) {
+            hidden++;
+        } else if (slot.sections) {
+            drawn++;
+            visible.push_back(step.offset);
+        }
+
+        const ChunkVisibility visibility = chunkmeshes.getVisibility(chunkpos);
+        for (Face face : all_faces) {
+            const unsigned int direction = 1u << static_cast<int>(face);
+            const unsigned int backwards = 1u << static_cast<int>(oppositeFace(face));
+            if ((step.directions & backwards) ||
+                (!start && !visibility.canSee(step.entered, face))) {
+                continue;
+            }
+
+            const glm::ivec3 next = adjacentPos(step.offset, face);
+            Slot *nextslot = getSlot(next);
+            if (!nextslot || nextslot->reached || !nextslot->in_frustum) {
+                continue;
+            }
+            nextslot->reached = true;
+            queue.push_back(Step{next, oppositeFace(face), step.directions | direction});
+        }
+    }
+
+    // The rest of the view distance is only meshed while there's room in
+    // the budget, and its meshes are the first to go when there isn't
+    for (int x = -radius; x <= radius; x++) {
+        for (int y = -radius; y <= radius; y++) {
+            for (int z = -vertical_radius; z <= vertical_radius; z++) {
+                const glm::ivec3 offset{x, y, z};
+                if (!getSlot(offset)->reached) {
+                    const int lod = view_distance.getLOD(offset);
+                    chunkmeshes.prefetchMesh(centerchunkpos + offset,
+                                             getNeighborhood(offset, lod), lod);
+                }
+            }
+        }
+    }
+
+    // Nearest first, so that the hardware can skip the fragments of
+    // anything behind what's already drawn
+    auto distance2 = [&](const glm::ivec3 &offset) {
+        const glm::vec3 d = glm::vec3{32*offset} + .5f*chunksize - eye;
+        return d.x*d.x + d.y*d.y + d.z*d.z;
+    };
+    std::sort(visible.begin(), visible.end(),
+              [&](const glm::ivec3 &a, const glm::ivec3 &b) {
+                  return distance2(a) < distance2(b);
+              });
+
+    // All the visible chunk sections are queued up and drawn in one go,
+    // opaque faces first, then the cutout blocks, whose shader discards
+    // texels, and last the plants, instanced
+    auto forEachSection = [&](const std::function<void(
+                                  const ChunkMeshManager::SectionMesh &,
+                                  const glm::vec3 &offset,
+                                  uint32_t ranges)> &fn) {
+        for (const glm::ivec3 &chunkoffset : visible) {
+            const auto &sections = *getSlot(chunkoffset)->sections;
+            // Offsets are relative to the centre chunk, to keep the
+            // floats small
+            const glm::vec3 offset{32*chunkoffset};
+            for (int section = 0; section < BlockVisualRegistry::SectionCount; section++) {
+                const glm::vec3 min =
+                    offset + glm::vec3{0, 0, section*BlockVisualRegistry::SectionHeight};
+                const glm::vec3 max =
+                    min + glm::vec3{Chunk::XSize, Chunk::YSize, BlockVisualRegistry::SectionHeight};
+                if (!frustum.intersects(min, max)) {
                     continue;
                 }
-                
-                glm::mat4 model{1};
-                model = glm::translate(model, glm::vec3{32*chunkpos});
-                prgm.setUniform("modelview", view*model);
-                meshptr->draw(prgm);
+                // Leave out the faces pointing away from the camera
+                fn(sections[section], offset,
+                   BlockVisualRegistry::getVisibleRanges(eye, min, max));
             }
         }
+    };
+
+    MeshArena &arena = chunkmeshes.getArena();
+    long draw_calls = 0, triangles = 0;
+    auto drawPass = [&](ShaderProgram &prgm, uint32_t pass_ranges) {
+        forEachSection([&](const ChunkMeshManager::SectionMesh &section,
+                           const glm::vec3 &offset, uint32_t ranges) {
+            if (section.mesh) {
+                arena.addDraw(*section.mesh, offset, ranges & pass_ranges);
+            }
+        });
+        arena.draw(prgm);
+        draw_calls += arena.getLastDrawCount();
+        triangles += arena.getLastIndexCount() / 3;
+    };
+    drawPass(opaque_prgm, ~BlockVisualRegistry::CutoutRanges);
+    drawPass(cutout_prgm, BlockVisualRegistry::CutoutRanges);
+
+    InstanceArena &plant_arena = chunkmeshes.getPlantArena();
+    forEachSection([&](const ChunkMeshManager::SectionMesh &section,
+                       const glm::vec3 &offset, uint32_t ranges) {
+        plant_arena.addDraw(section.plants, offset);
+    });
+    plant_arena.draw(plant_prgm);
+    draw_calls += plant_arena.getLastDrawCount();
+    triangles += plant_arena.getLastInstanceCount() * plant_arena.getMeshIndexCount() / 3;
+
+    long meshed = 0;
+    for (const Slot &slot : slots) {
+        meshed += slot.sections != nullptr;
     }
+    stats.chunks_drawn.set(drawn);
+    stats.chunks_culled.set(culled);
+    stats.chunks_occluded.set(meshed - drawn - hidden - culled);
+    stats.chunks_hidden.set(hidden);
+    stats.occluders.set(occluders.size());
+    stats.draw_calls.set(draw_calls);
+    stats.triangles.set(triangles);
 
-    chunkmeshes.freeUnusedMeshes();
+    if (!occlusion_pending) {
+        asyncTestOcclusion(proj*view*model, camera.pos, centerchunkpos,
+                           std::move(occluders), std::move(candidates));
+    }
+
+    chunkmeshes.retireUploads();
+    chunkmeshes.evictMeshes();
 }
     
+void WorldView::asyncTestOcclusion(const glm::mat4 &projview,
+                                   const glm::vec3 &eye,
+                                   const glm::ivec3 &centerchunkpos,
+                                   std::vector<OcclusionBox> occluders,
+                                   std::vector<glm::ivec3> candidates) {
+    occlusion_pending = true;
+    tm.postWork([=,
+                 occluders = std::move(occluders),
+                 candidates = std::move(candidates)](WorkerThread &wt) {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+
+        auto &buffer = wt.cacheLocal<OcclusionBuffer>("OcclusionBuffer");
+        buffer.reset(projview);
+        const glm::vec3 slack{OcclusionSlack};
+        for (const OcclusionBox &box : occluders) {
+            const glm::vec3 min = box.min + slack, max = box.max - slack;
+            if (min.x < max.x && min.y < max.y && min.z < max.z) {
+                buffer.drawOccluder(min, max);
+            }
+        }
+
+        std::unordered_set<glm::ivec3> hidden;
+        const glm::vec3 chunksize{Chunk::XSize, Chunk::YSize, Chunk::ZSize};
+        for (const glm::ivec3 &offset : candidates) {
+            const glm::vec3 min{32*offset};
+            if (!buffer.isVisible(min, min + chunksize)) {
+                hidden.insert(centerchunkpos + offset);
+            }
+        }
+
+        const std::chrono::duration<float, std::milli> time = Clock::now() - start;
+        tm.postMain([=, hidden = std::move(hidden)]() {
+            hidden_chunks = std::move(hidden);
+            occlusion_eye = eye;
+            occlusion_times.add(time.count());
+            occlusion_pending = false;
+        });
+    });
+}
+
+int WorldView::ViewDistance::getLOD(const glm::ivec3 &offset) const {
+    const int dist = std::max(std::max(std::abs(offset.x), std::abs(offset.y)),
+                              std::abs(offset.z));
+    for (unsigned int lod = 0; lod < lod_radius.size(); lod++) {
+        if (dist <= lod_radius[lod]) {
+            return lod;
+        }
+    }
+    return lod_radius.size();
+}
+
 PerspectiveProjection WorldView::getProjection(Window &window) {
     PerspectiveProjection proj;
     proj.aspect = window.getAspectRatio();
@@ -7,30 +7,110 @@
 #include "gfx/Shader.h"
 #include "gfx/ChunkMeshManager.h"
 #include "gfx/Camera.h"
+#include "util/Counter.h"
+#include "util/SampleWindow.h"
 #include "World.h"
 
+#include <array>
+#include <unordered_set>
+
 class WorldView : public View {
 public:
     WorldView(ThreadManager &tm,
               const World &world,
               Sampler sampler,
-              ShaderProgram prgm,
+              ShaderProgram opaque_prgm,
+              ShaderProgram cutout_prgm,
+              ShaderProgram plant_prgm,
               BlockVisualRegistry blockvisuals);
 
     RPYCamera &getCamera() { return camera; }
     const RPYCamera &getCamera() const { return camera; }
 
+    const ChunkMeshManager &getChunkMeshes() const { return chunkmeshes; }
+
+    // In chunks. Chunks within lod_radius[n] of the camera are drawn at
+    // level of detail n, and anything further out at the coarsest level
+    // up to the view radius.
+    struct ViewDistance {
+        int radius = 12;
+        int vertical_radius = 3;
+        std::array<int, ChunkMeshManager::LODCount - 1> lod_radius{{3, 6}};
+        // Chunks within occluder_radius draw their solid ground into the
+        // occlusion buffer, which chunks beyond test_radius are tested
+        // against
+        int occluder_radius = 3;
+        int test_radius = 1;
+
+        int getLOD(const glm::ivec3 &offset) const;
+    };
+    ViewDistance &getViewDistance() { return view_distance; }
+    const ViewDistance &getViewDistance() const { return view_distance; }
+
+    // Of the chunks with meshes in the view distance, last frame. Culled
+    // chunks are outside the view frustum, occluded ones walled off from
+    // the camera (see ChunkVisibility) and hidden ones behind the
+    // occlusion buffer's occluders.
+    struct Stats {
+        Counter chunks_drawn;
+        Counter chunks_culled;
+        Counter chunks_occluded;
+        Counter chunks_hidden;
+        Counter occluders;
+        Counter draw_calls;
+        Counter triangles;
+    };
+    const Stats &getStats() const { return stats; }
+    // Milliseconds a worker spends drawing and testing the occlusion
+    // buffer, for recent frames
+    const SampleWindow &getOcclusionTimes() const { return occlusion_times; }
+
+    // The texture unit the face records are bound to, with
+    // ChunkGeometry::FACES
+    static constexpr unsigned int FaceTextureUnit = 1;
+
     virtual void render(Window &window);
 
     PerspectiveProjection getProjection(Window &window); // TODO
 
 private:
+    ThreadManager &tm;
     const World &world;
     Sampler sampler;
-    ShaderProgram prgm;
+    // The cutout program discards see-through texels, the opaque one
+    // leaves them out so that depth can be tested early
+    ShaderProgram opaque_prgm;
+    ShaderProgram cutout_prgm;
+    ShaderProgram plant_prgm;
 
     ChunkMeshManager chunkmeshes;
     RPYCamera camera;
+    ViewDistance view_distance;
+    Stats stats;
+
+    // The occlusion buffer is drawn and tested on a worker, a frame or
+    // more behind the camera. Its occluders are shrunk by OcclusionSlack
+    // all round, so that anything hidden behind them from the eye they
+    // were drawn from stays hidden from anywhere within OcclusionSlack of
+    // it, and which way the camera faces doesn't matter (see
+    // OcclusionBuffer::isVisible). Hidden chunks are only skipped while
+    // the camera stays that close to occlusion_eye, and the results are
+    // thrown away once it moves further.
+    static constexpr float OcclusionSlack = 2;
+    bool occlusion_pending = false;
+    glm::vec3 occlusion_eye;
+    std::unordered_set<glm::ivec3> hidden_chunks;
+    SampleWindow occlusion_times;
+
+    struct OcclusionBox {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+    void asyncTestOcclusion(const glm::mat4 &projview,
+                            const glm::vec3 &eye,
+                            const glm::ivec3 &centerchunkpos,
+                            std::vector<OcclusionBox> occluders,
+                            std::vector<glm::ivec3> candidates);
 };
 
 #endif
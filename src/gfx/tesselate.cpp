@@ -6,31 +6,37 @@ void tesselate(MeshBuilder &builder,
                const Font &font,
                const std::string &str) {
     builder.reset(MeshFormat{2, 2});
+    builder.reserveQuads(str.size());
 
     const float texwidth = font.getTexture().getWidth();
     const float texheight = font.getTexture().getHeight();
 
     int curx = 0;
+    int cury = 0;
     for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == '\n') {
+            curx = 0;
+            cury -= font.getLineHeight();
+            continue;
+        }
+
         auto propsptr = font.getProps(str[i]);
         if (!propsptr)
             continue;
 
         const float xmin = curx + propsptr->xoffset;
         const float xmax = xmin + propsptr->width;
-        const float ymax = font.getBaseHeight() - propsptr->yoffset;
+        const float ymax = cury + font.getBaseHeight() - propsptr->yoffset;
         const float ymin = ymax - propsptr->height;
         const float txmin = propsptr->x / texwidth;
         const float txmax = txmin + propsptr->width / texwidth;
         const float tymax = 1 - propsptr->y / texheight;
         const float tymin = tymax - propsptr->height / texheight;
 
-        builder.makeVert(glm::vec4{xmin, ymin, txmin, tymin});
-        MeshBuilder::Index a = builder.makeVert(glm::vec4{xmax, ymin, txmax, tymin});
-        MeshBuilder::Index b = builder.makeVert(glm::vec4{xmin, ymax, txmin, tymax});
-        builder.repeatVert(a);
-        builder.makeVert(glm::vec4{xmax, ymax, txmax, tymax});
-        builder.repeatVert(b);
+        builder.appendQuad(std::array<glm::vec2, 4>{{{xmin, ymin}, {xmax, ymin},
+                                                     {xmin, ymax}, {xmax, ymax}}},
+                           std::array<glm::vec2, 4>{{{txmin, tymin}, {txmax, tymin},
+                                                     {txmin, tymax}, {txmax, tymax}}});
 
         curx += propsptr->xadvance;
     }
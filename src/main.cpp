@@ -10,13 +10,13 @@
 #include "gfx/Image.h"
 #include "gfx/Texture.h"
 #include "gfx/Window.h"
-#include "perlin.h"
 #include "gfx/Font.h"
 #include "gfx/TextureArrayBuilder.h"
 #include "gfx/WorldView.h"
 #include "gfx/DebugView.h"
 #include "gfx/SimpleBlockVisual.h"
 #include "gfx/PlantBlockVisual.h"
+#include "TestWorldGenerator.h"
 #include <unistd.h>
 #include <iostream>
 #include <tuple>
@@ -30,82 +30,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <fstream>
+#include <string>
+#include <vector>
 
 const float pi = static_cast<float>(M_PI);
 
-class TestWorldGenerator : public WorldGenerator {
-public:
-    TestWorldGenerator() : seed(0) { }
-
-    bool solid(glm::vec3 pos) const {
-        float val = 2*perlin3(pos, seed);
-
-        glm::vec3 threshpos{pos.x/20, pos.y/20, 0};
-        float thresh = pos.z + 5*perlin3(threshpos, seed ^ 0x1);
-
-        return val > thresh;
-    }
-
-    std::unique_ptr<Chunk> generateChunk(
-        const glm::ivec3 &chunkpos,
-        const BlockTypeRegistry &blocktypes) const
-    {
-        const auto &air = blocktypes.getType("air");
-        const auto &grass = blocktypes.getType("grass");
-        const auto &dirt = blocktypes.getType("dirt");
-        const auto &stone = blocktypes.getType("stone");
-        const auto &tall_grass = blocktypes.getType("tall_grass");
-
-        std::unique_ptr<Chunk> chunk{new Chunk{blocktypes}};
-        chunk->fill(air);
-
-        for (auto &pos : ChunkIndex::range) {
-            glm::vec3 worldpos = static_cast<glm::vec3>(chunkpos) +
-                static_cast<glm::vec3>(pos.getVec())/32.0f;
-            chunk->setBlock(pos, solid(worldpos) ? stone : air);
-        }
-
-        for (int x=0; x<Chunk::XSize; x++) {
-            for (int y=0; y<Chunk::YSize; y++) {
-                int ctr = 0;
-
-                glm::vec3 pos_above{chunkpos.x + x/32.0f,
-                                    chunkpos.y + y/32.0f,
-                                    chunkpos.z+1};
-                if (solid(pos_above))
-                    continue;
-
-                bool has_tall_grass = perlin3(pos_above, seed ^ 0x02) > 0.2f;
-                
-                for (int z=Chunk::ZSize-1; z>=0; z--) {
-                    ChunkIndex idx{x, y, z};
-                    auto b = chunk->getBlock(idx);
-                    if (b.getType() == stone) {
-                        if (ctr == 0) {
-                            chunk->setBlock(idx, has_tall_grass ? tall_grass : grass);
-                        } else if (ctr == 1) {
-                            chunk->setBlock(idx, has_tall_grass ? grass : dirt);
-                        } else {
-                            chunk->setBlock(idx, dirt);
-                        }
-
-                        if (++ctr >= 4) {
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-
-        return chunk;
-    }
-
-    void reseed(int seed) { this->seed = seed; }
-
-private:
-    int seed;
-};
-
 static void buildMetaTables(Lua &lua) {
     MetatableBuilder<FaceMap<unsigned int>>(lua, "FaceMapUInt")
         .index<Face, unsigned int>()
@@ -117,7 +46,8 @@ static void buildMetaTables(Lua &lua) {
     
     MetatableBuilder<BlockTypeInfo>(lua, "BlockTypeInfo")
         .constructor("new")
-        .field("solid", &BlockTypeInfo::solid);
+        .field("solid", &BlockTypeInfo::solid)
+        .field("light", &BlockTypeInfo::light);
 
     MetatableBuilder<const BlockType>(lua, "ConstBlockType")
 //        .field("solid", &BlockType::solid) // TODO, base class fields?
@@ -151,21 +81,37 @@ static std::unique_ptr<View> buildWorldView(ThreadManager &tm,
                                             BlockVisualRegistry &blockvisuals) {
     Sampler sampler;
     sampler.setFilter(Sampler::NEAREST);
+    sampler.setWrap(true); // greedy meshed faces tile their textures
 
-    Shader vert{Shader::Type::VERTEX, "vert.glsl"};
-    Shader frag{Shader::Type::FRAGMENT, "frag.glsl"};
-    ShaderProgram prgm{vert, frag};
+    // Face records are expanded by the chunk shaders, plants stay
+    // instanced vertices either way
+    std::vector<std::string> chunk_defines;
+    if (blockvisuals.getGeometry() == ChunkGeometry::FACES) {
+        chunk_defines.push_back("FACE_RECORDS");
+    }
+
+    Shader vert{Shader::Type::VERTEX, "vert.glsl", chunk_defines};
+    Shader opaque_frag{Shader::Type::FRAGMENT, "frag.glsl"};
+    Shader cutout_frag{Shader::Type::FRAGMENT, "frag.glsl", {"CUTOUT"}};
+    Shader plant_vert{Shader::Type::VERTEX, "vert.glsl", {"PLANT_INSTANCES"}};
+    ShaderProgram opaque_prgm{vert, opaque_frag};
+    ShaderProgram cutout_prgm{vert, cutout_frag};
+    ShaderProgram plant_prgm{plant_vert, cutout_frag};
     
     return std::unique_ptr<View>{
         new WorldView{
             tm,
             world,
             std::move(sampler),
-            std::move(prgm),
+            std::move(opaque_prgm),
+            std::move(cutout_prgm),
+            std::move(plant_prgm),
             std::move(blockvisuals)}};
 }
 
-static std::unique_ptr<View> buildDebugView() {
+static std::unique_ptr<View> buildDebugView(const ThreadManager &tm,
+                                            const World &world,
+                                            const WorldView &worldview) {
     Font font{"font.fnt"};
 
     Shader vert{Shader::Type::VERTEX, "vert2d.glsl"};
@@ -173,7 +119,7 @@ static std::unique_ptr<View> buildDebugView() {
     ShaderProgram prgm{vert, frag};
 
     return std::unique_ptr<View>{new DebugView{
-        std::move(font), std::move(prgm)}};
+        std::move(font), std::move(prgm), tm, world, worldview}};
 }
 
 int main(int argc, char **argv) {
@@ -187,6 +133,9 @@ int main(int argc, char **argv) {
 
     BlockTypeRegistry blocktypes;
     BlockVisualRegistry blockvisuals{16};
+    // Given --faces, chunks are drawn from one packed record per face
+    // rather than four vertices, to compare the two
+    const bool faces = argc > 1 && std::string{argv[1]} == "--faces";
     
     tm.postWork([&](WorkerThread &th) {
         auto &lua = th.cacheLocal<Lua>("lua");
@@ -202,16 +151,22 @@ int main(int argc, char **argv) {
     World world(blocktypes, gen, tm);
 
     auto regenWorld = [&]() {
-        world.getChunks().clearAllChunks();
+        world.clearAllChunks();
         gen.reseed(rand());
     };
     regenWorld();
 
     GraphicsSystem gfx{tm};
+    if (faces && ChunkMeshManager::canDrawFaces()) {
+        blockvisuals.setGeometry(ChunkGeometry::FACES);
+    } else if (faces) {
+        std::cerr << "Buffer textures are too small for face records, "
+                  << "drawing vertices instead" << std::endl;
+    }
     gfx.pushView(buildWorldView(tm, world, blockvisuals));
-    gfx.pushView(buildDebugView());
-
     auto &worldview = gfx.getView<WorldView>(0);
+    gfx.pushView(buildDebugView(tm, world, worldview));
+
 //    auto &debugview = gfx.getView<DebugView>(1);
 
     worldview.getCamera().pos.z = 40;
@@ -240,19 +195,16 @@ int main(int argc, char **argv) {
                 window.getNDCPos(window.getMousePos()));
             auto pick = world.getChunks().pick(pos, dir, 10);
             if (pick) {
-                glm::ivec3 chunkpos, blockpos;
-                std::tie(chunkpos, blockpos) = ChunkGrid::posToChunkBlock(*pick);
-                std::unique_ptr<Chunk> newchunk{
-                    new Chunk(*world.getChunks().getChunk(chunkpos))};
-                newchunk->setBlock(ChunkIndex{blockpos}, air);
-                world.getChunks().setChunk(chunkpos, std::move(newchunk));
+                world.setBlock(*pick, air);
             }
         }
 
         glm::ivec3 camera_chunkpos = ChunkGrid::posToChunkBlock(
             glm::ivec3{floorVec(camera.pos)}).first;
 
-        static constexpr int range = 8;
+        // Generate out to the view distance, where far chunks get drawn
+        // at a lower level of detail
+        const int range = 2*worldview.getViewDistance().radius;
         static constexpr int zrange = 4;
         for (int i=0; i<10; i++) {
             glm::ivec3 chunkpos = camera_chunkpos;
@@ -261,6 +213,7 @@ int main(int argc, char **argv) {
             chunkpos.z = (rand() % zrange) - zrange/2;
             world.asyncGenerateChunk(chunkpos);
         }
+        world.updateLight();
 
 	return true;
     });
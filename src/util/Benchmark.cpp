@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <utility>
+#include <cmath>
+
+BenchmarkState::BenchmarkState(Clock::duration min_time) :
+    min_time(min_time),
+    iterations(0),
+    items(0) { }
+
+bool BenchmarkState::keepRunning() {
+    auto now = Clock::now();
+    if (iterations == 0) {
+        start = now;
+    } else if (now - start >= min_time) {
+        stop = now;
+        return false;
+    }
+
+    iterations++;
+    return true;
+}
+
+double BenchmarkState::getSeconds() const {
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+static std::vector<std::pair<std::string, Benchmark::Func>> &getBenchmarks() {
+    static std::vector<std::pair<std::string, Benchmark::Func>> benchmarks;
+    return benchmarks;
+}
+
+bool Benchmark::add(const std::string &name, Func func) {
+    getBenchmarks().emplace_back(name, std::move(func));
+    return true;
+}
+
+static void printTable(const std::string &name, const BenchmarkState &state) {
+    const double secs = state.getSeconds();
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(10) << state.getIterations() << " iters "
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << 1e6*secs/state.getIterations() << " us/iter";
+    if (state.getItems() > 0) {
+        std::cout << ' ' << std::setprecision(0)
+                  << state.getItems()/secs << " items/s";
+    }
+    for (auto &counter : state.getCounters()) {
+        std::cout << ' ' << counter.first << '=' << std::setprecision(1)
+                  << counter.second;
+    }
+    std::cout << std::endl;
+}
+
+static void printJSONString(const std::string &str) {
+    std::cout << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            std::cout << '\\';
+        }
+        std::cout << c;
+    }
+    std::cout << '"';
+}
+
+static void printJSONNumber(double val) {
+    if (std::isfinite(val)) {
+        std::cout << val;
+    } else {
+        std::cout << "null";
+    }
+}
+
+static void printJSON(const std::string &name, const BenchmarkState &state, bool first) {
+    const double secs = state.getSeconds();
+    std::cout << (first ? "[\n" : ",\n") << "  {\"name\": ";
+    printJSONString(name);
+    std::cout << ", \"iterations\": " << state.getIterations()
+              << ", \"us_per_iter\": ";
+    printJSONNumber(1e6*secs/state.getIterations());
+    std::cout << ", \"items_per_sec\": ";
+    printJSONNumber(state.getItems()/secs);
+    std::cout << ", \"counters\": {";
+    bool first_counter = true;
+    for (auto &counter : state.getCounters()) {
+        if (!first_counter) {
+            std::cout << ", ";
+        }
+        first_counter = false;
+        printJSONString(counter.first);
+        std::cout << ": ";
+        printJSONNumber(counter.second);
+    }
+    std::cout << "}}";
+}
+
+int Benchmark::runAll(int argc, char **argv) {
+    std::string filter;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else {
+            filter = arg;
+        }
+    }
+
+    bool first = true;
+    bool failed = false;
+    for (auto &bench : getBenchmarks()) {
+        if (bench.first.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        BenchmarkState state{std::chrono::seconds(1)};
+        bench.second(state);
+        if (state.getIterations() == 0) {
+            // Stop here, but still close off the JSON printed so far
+            std::cerr << bench.first << " never ran" << std::endl;
+            failed = true;
+            break;
+        }
+
+        if (json) {
+            printJSON(bench.first, state, first);
+        } else {
+            printTable(bench.first, state);
+        }
+        first = false;
+    }
+
+    if (json) {
+        std::cout << (first ? "[]" : "\n]") << std::endl;
+    }
+    return failed ? 1 : 0;
+}
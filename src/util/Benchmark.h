@@ -0,0 +1,72 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+
+// A tiny benchmark harness in the spirit of gtest. Benchmarks live next
+// to the code they measure in *_bench.cpp files and are linked into
+// kube_bench:
+//
+//   BENCHMARK(Group, Name) {
+//       ... setup ...
+//       while (state.keepRunning()) {
+//           ... measured code ...
+//       }
+//   }
+class BenchmarkState {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit BenchmarkState(Clock::duration min_time);
+
+    // Starts the clock on the first call, and keeps returning true
+    // until the benchmark has run for at least min_time.
+    bool keepRunning();
+
+    // Items processed (blocks, chunks, ...), reported per second
+    void addItems(double n) { items += n; }
+    void setCounter(const std::string &name, double val) { counters[name] = val; }
+
+    unsigned long getIterations() const { return iterations; }
+    double getSeconds() const;
+    double getItems() const { return items; }
+    const std::map<std::string, double> &getCounters() const { return counters; }
+
+private:
+    Clock::duration min_time;
+    Clock::time_point start;
+    Clock::time_point stop;
+    unsigned long iterations;
+    double items;
+    std::map<std::string, double> counters;
+};
+
+class Benchmark {
+public:
+    using Func = std::function<void (BenchmarkState &)>;
+
+    static bool add(const std::string &name, Func func);
+
+    // Runs every benchmark whose name contains the filter argument, or
+    // all of them. With --json, the results are printed as a JSON array
+    // rather than a table, for keeping track of them across changes:
+    //
+    //   kube_bench [--json] [filter]
+    static int runAll(int argc, char **argv);
+
+    // Heap allocations made by the process so far, counted by kube_bench's
+    // operator new (see bench_main.cpp), for telling how much a benchmark
+    // allocates once it's warmed up
+    static unsigned long getAllocationCount();
+};
+
+#define BENCHMARK(group, name)                                          \
+    static void bench_##group##_##name(BenchmarkState &state);         \
+    static const bool bench_##group##_##name##_added =                  \
+        Benchmark::add(#group "/" #name, &bench_##group##_##name);     \
+    static void bench_##group##_##name(BenchmarkState &state)
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <atomic>
+
+// A statistic which can be bumped from any thread. Readers only sample
+// it once a frame for display, so relaxed ordering is plenty and the
+// counters are cheap enough to leave on in every build.
+class Counter {
+public:
+    Counter() : val(0) { }
+    Counter(const Counter &) = delete;
+    Counter &operator=(const Counter &) = delete;
+
+    void add(long n=1) { val.fetch_add(n, std::memory_order_relaxed); }
+    void sub(long n=1) { val.fetch_sub(n, std::memory_order_relaxed); }
+    void set(long n) { val.store(n, std::memory_order_relaxed); }
+    long get() const { return val.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<long> val;
+};
+
+#endif
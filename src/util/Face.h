@@ -11,6 +11,10 @@ extern const std::array<glm::ivec3, 6> face_normals;
 
 Optional<Face> sharedFace(const glm::ivec3 &a, const glm::ivec3 &b);
 glm::ivec3 adjacentPos(const glm::ivec3 &pos, Face face);
+// Faces come in opposing pairs
+inline Face oppositeFace(Face face) {
+    return static_cast<Face>(static_cast<int>(face) ^ 1);
+}
 inline const glm::ivec3 &faceNormal(Face face) {
     return face_normals[static_cast<int>(face)];
 }
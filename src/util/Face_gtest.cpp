@@ -34,6 +34,12 @@ TEST(AdjacentPos, Simple) {
     }
 }
 
+TEST(OppositeFace, Normals) {
+    for (auto face : all_faces) {
+        EXPECT_EQ(-faceNormal(face), faceNormal(oppositeFace(face)));
+    }
+}
+
 TEST(FaceMap, Simple) {
     FaceMap<int> fmap;
     fmap.fill(0);
@@ -0,0 +1,82 @@
+#include "RangeAllocator.h"
+#include <stdexcept>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(size_t size) : size(0), used(0) {
+    grow(size);
+}
+
+Optional<size_t> RangeAllocator::allocate(size_t len) {
+    if (len == 0) {
+        return None;
+    }
+
+    auto fit = free_by_size.lower_bound(len);
+    if (fit == free_by_size.end()) {
+        return None;
+    }
+
+    const size_t offset = fit->second;
+    const size_t fitlen = fit->first;
+    removeFree(free_by_offset.find(offset));
+    if (fitlen > len) {
+        addFree(offset + len, fitlen - len);
+    }
+
+    used += len;
+    return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t len) {
+    if (offset + len > size || len > used) {
+        throw std::logic_error("Freeing a range that was never allocated");
+    }
+    used -= len;
+
+    // Merge with the free ranges on either side
+    auto next = free_by_offset.lower_bound(offset);
+    if (next != free_by_offset.end() && next->first == offset + len) {
+        len += next->second;
+        next = removeFree(next);
+    }
+    if (next != free_by_offset.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            len += prev->second;
+            removeFree(prev);
+        }
+    }
+
+    addFree(offset, len);
+}
+
+void RangeAllocator::grow(size_t newsize) {
+    if (newsize < size) {
+        throw std::logic_error("RangeAllocator can't shrink");
+    } else if (newsize == size) {
+        return;
+    }
+
+    const size_t oldsize = size;
+    size = newsize;
+    // Freeing the new space merges it with a free range at the end
+    used += newsize - oldsize;
+    free(oldsize, newsize - oldsize);
+}
+
+void RangeAllocator::addFree(size_t offset, size_t len) {
+    free_by_offset.emplace(offset, len);
+    free_by_size.emplace(len, offset);
+}
+
+RangeAllocator::FreeIter RangeAllocator::removeFree(FreeIter iter) {
+    auto sizes = free_by_size.equal_range(iter->second);
+    for (auto i = sizes.first; i != sizes.second; ++i) {
+        if (i->second == iter->first) {
+            free_by_size.erase(i);
+            break;
+        }
+    }
+    return free_by_offset.erase(iter);
+}
@@ -0,0 +1,40 @@
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+#include "util/Optional.h"
+
+#include <map>
+#include <cstddef>
+
+// Hands out [offset, offset+size) ranges of a larger space, such as a
+// GPU buffer. Allocation is best fit, and freed ranges are merged with
+// their free neighbours. Doesn't touch the space itself.
+class RangeAllocator {
+public:
+    explicit RangeAllocator(size_t size = 0);
+
+    Optional<size_t> allocate(size_t size);
+    void free(size_t offset, size_t size);
+
+    // Extends the space to size, which must not be smaller than it was
+    void grow(size_t size);
+
+    size_t getSize() const { return size; }
+    size_t getUsed() const { return used; }
+    size_t getFreeRangeCount() const { return free_by_offset.size(); }
+
+private:
+    size_t size;
+    size_t used;
+
+    // offset -> size, and size -> offset
+    std::map<size_t, size_t> free_by_offset;
+    std::multimap<size_t, size_t> free_by_size;
+
+    using FreeIter = std::map<size_t, size_t>::iterator;
+    void addFree(size_t offset, size_t size);
+    // Returns the next free range by offset
+    FreeIter removeFree(FreeIter iter);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "util/RangeAllocator.h"
+#include <gtest/gtest.h>
+
+TEST(RangeAllocator, AllocatesInOrder) {
+    RangeAllocator alloc{100};
+    auto a = alloc.allocate(10);
+    auto b = alloc.allocate(20);
+    ASSERT_TRUE(static_cast<bool>(a));
+    ASSERT_TRUE(static_cast<bool>(b));
+    EXPECT_EQ(0u, *a);
+    EXPECT_EQ(10u, *b);
+    EXPECT_EQ(30u, alloc.getUsed());
+}
+
+TEST(RangeAllocator, FailsWhenFull) {
+    RangeAllocator alloc{16};
+    EXPECT_TRUE(static_cast<bool>(alloc.allocate(16)));
+    EXPECT_FALSE(static_cast<bool>(alloc.allocate(1)));
+    EXPECT_FALSE(static_cast<bool>(RangeAllocator{8}.allocate(9)));
+}
+
+TEST(RangeAllocator, MergesFreedRanges) {
+    RangeAllocator alloc{30};
+    auto a = alloc.allocate(10);
+    auto b = alloc.allocate(10);
+    auto c = alloc.allocate(10);
+    alloc.free(*a, 10);
+    alloc.free(*c, 10);
+    EXPECT_EQ(2u, alloc.getFreeRangeCount());
+    EXPECT_FALSE(static_cast<bool>(alloc.allocate(20)));
+
+    alloc.free(*b, 10);
+    EXPECT_EQ(1u, alloc.getFreeRangeCount());
+    EXPECT_EQ(0u, alloc.getUsed());
+    auto all = alloc.allocate(30);
+    ASSERT_TRUE(static_cast<bool>(all));
+    EXPECT_EQ(0u, *all);
+}
+
+TEST(RangeAllocator, BestFit) {
+    RangeAllocator alloc{100};
+    auto a = alloc.allocate(20);
+    alloc.allocate(10);
+    auto c = alloc.allocate(5);
+    alloc.allocate(10);
+    alloc.free(*a, 20);
+    alloc.free(*c, 5);
+
+    // The 5 block hole fits better than the 20 block one
+    auto d = alloc.allocate(4);
+    ASSERT_TRUE(static_cast<bool>(d));
+    EXPECT_EQ(*c, *d);
+}
+
+TEST(RangeAllocator, Grow) {
+    RangeAllocator alloc{10};
+    auto a = alloc.allocate(5);
+    EXPECT_FALSE(static_cast<bool>(alloc.allocate(10)));
+
+    alloc.grow(20);
+    EXPECT_EQ(20u, alloc.getSize());
+    EXPECT_EQ(1u, alloc.getFreeRangeCount());
+    auto b = alloc.allocate(15);
+    ASSERT_TRUE(static_cast<bool>(b));
+    EXPECT_EQ(*a + 5, *b);
+}
@@ -0,0 +1,50 @@
+#include "SampleWindow.h"
+#include <algorithm>
+#include <cassert>
+
+SampleWindow::SampleWindow(size_t size) :
+    samples(size),
+    next(0),
+    count(0)
+{
+    assert(size > 0);
+    scratch.reserve(size);
+}
+
+void SampleWindow::add(float sample) {
+    samples[next] = sample;
+    if (++next >= samples.size()) {
+        next = 0;
+    }
+    if (count < samples.size()) {
+        count++;
+    }
+}
+
+void SampleWindow::clear() {
+    next = 0;
+    count = 0;
+}
+
+float SampleWindow::getMax() const {
+    if (count == 0) {
+        return 0;
+    }
+
+    return *std::max_element(std::begin(samples), std::begin(samples) + count);
+}
+
+float SampleWindow::getPercentile(float p) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    p = std::min(std::max(p, 0.0f), 1.0f);
+    size_t rank = static_cast<size_t>(p*(count-1) + 0.5f);
+
+    scratch.assign(std::begin(samples), std::begin(samples) + count);
+    std::nth_element(std::begin(scratch),
+                     std::begin(scratch) + rank,
+                     std::end(scratch));
+    return scratch[rank];
+}
@@ -0,0 +1,30 @@
+#ifndef SAMPLEWINDOW_H
+#define SAMPLEWINDOW_H
+
+#include <vector>
+#include <cstddef>
+
+// Keeps the most recent N samples of some measurement (frame times, etc)
+// and answers percentile queries over them.
+class SampleWindow {
+public:
+    explicit SampleWindow(size_t size);
+
+    void add(float sample);
+    void clear();
+
+    size_t getCount() const { return count; }
+    float getMax() const;
+
+    // p in [0, 1]. Returns 0 if there are no samples yet.
+    float getPercentile(float p) const;
+
+private:
+    std::vector<float> samples;
+    size_t next;
+    size_t count;
+
+    mutable std::vector<float> scratch;
+};
+
+#endif
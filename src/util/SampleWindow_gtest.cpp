@@ -0,0 +1,38 @@
+#include "SampleWindow.h"
+#include <gtest/gtest.h>
+
+TEST(SampleWindow, Empty) {
+    SampleWindow window(8);
+    EXPECT_EQ(0u, window.getCount());
+    EXPECT_EQ(0, window.getPercentile(.5));
+    EXPECT_EQ(0, window.getMax());
+}
+
+TEST(SampleWindow, Percentiles) {
+    SampleWindow window(101);
+    for (int i = 100; i >= 0; i--) {
+        window.add(i);
+    }
+
+    EXPECT_EQ(101u, window.getCount());
+    EXPECT_EQ(0, window.getPercentile(0));
+    EXPECT_EQ(50, window.getPercentile(.5));
+    EXPECT_EQ(90, window.getPercentile(.9));
+    EXPECT_EQ(99, window.getPercentile(.99));
+    EXPECT_EQ(100, window.getPercentile(1));
+    EXPECT_EQ(100, window.getMax());
+}
+
+TEST(SampleWindow, Wraps) {
+    SampleWindow window(4);
+    for (int i = 0; i < 4; i++) {
+        window.add(100);
+    }
+    for (int i = 0; i < 4; i++) {
+        window.add(i);
+    }
+
+    EXPECT_EQ(4u, window.getCount());
+    EXPECT_EQ(3, window.getMax());
+    EXPECT_EQ(0, window.getPercentile(0));
+}
@@ -10,7 +10,12 @@ void ThreadManager::stopThreads() {
         thread.stop();
     }
 
+    // With the workers gone nothing posts any more, and the work left
+    // over is dropped here rather than when the manager is destroyed,
+    // after whatever it refers to (such as mesh uploads into a view's
+    // arenas)
     main.stop();
+    main.clear();
 }
 
 void ThreadManager::postWork(std::function<void ()> func, int priority) {
@@ -17,6 +17,7 @@ public:
 	main.stop();
     }
 
+    // Stops and joins the workers, and drops all the work still queued
     void stopThreads();
     
     void postWork(std::function<void ()> func, int priority=0);
@@ -28,6 +29,12 @@ public:
     }
 
     void syncWork() const;
+
+    unsigned int getWorkerCount() const { return threads.size(); }
+    unsigned int getWorkerQueueDepth(unsigned int num) const {
+	return threads[num].getQueueDepth();
+    }
+    unsigned int getMainQueueDepth() const { return main.getDepth(); }
     
 private:
     std::vector<WorkerThread> threads;
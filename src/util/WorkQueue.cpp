@@ -9,6 +9,7 @@ void WorkQueue::post(std::function<void ()> func, int priority) {
     std::unique_lock<std::mutex> lock{mutex};
     item_heap.emplace_back(std::move(func), priority);
     std::push_heap(std::begin(item_heap), std::end(item_heap));
+    depth.add();
     lock.unlock();
     cond.notify_all();
 }
@@ -28,6 +29,17 @@ void WorkQueue::stop() {
     cond.notify_all();
 }
 
+void WorkQueue::clear() {
+    std::unique_lock<std::mutex> lock{mutex};
+    std::vector<Item> items = std::move(item_heap);
+    item_heap.clear();
+    depth.sub(items.size());
+    lock.unlock();
+    // Items may post more as they're destroyed, so outside of the lock
+    items.clear();
+    cond.notify_all();
+}
+
 void WorkQueue::sync() const {
     std::unique_lock<std::mutex> lock{mutex};
     cond.wait(lock, [&]{ return idle_flag && item_heap.empty(); });
@@ -69,6 +81,7 @@ void WorkQueue::runItemWithoutLock(std::unique_lock<std::mutex> &lock) {
     Item item = std::move(item_heap.front());
     std::pop_heap(std::begin(item_heap), std::end(item_heap));
     item_heap.pop_back();
+    depth.sub();
 
     idle_flag = false;
     lock.unlock();
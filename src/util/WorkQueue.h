@@ -2,6 +2,7 @@
 #define WORKQUEUE_H
 
 #include "util/Optional.h"
+#include "util/Counter.h"
 #include <vector>
 #include <utility>
 #include <chrono>
@@ -15,9 +16,15 @@ public:
     void post(std::function<void ()> func, int priority=0);
     Optional<int> getMinimumPriority() const;
     void stop();
+    // Drops the items not yet started, destroying them on the calling
+    // thread
+    void clear();
 
     void sync() const;
 
+    // Number of items posted but not yet started, safe to read from any thread
+    unsigned int getDepth() const { return depth.get(); }
+
     void runAllWork();
     bool runSomeWork(std::chrono::milliseconds time);
     
@@ -40,6 +47,7 @@ private:
     std::vector<Item> item_heap;
     bool stop_flag;
     bool idle_flag;
+    Counter depth;
 
     void runItemWithoutLock(std::unique_lock<std::mutex> &lock);
 };
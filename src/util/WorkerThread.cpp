@@ -15,4 +15,5 @@ WorkerThread::~WorkerThread() {
 void WorkerThread::stop() {
     queue.stop();
     thread.join();
+    queue.clear();
 }
@@ -20,6 +20,7 @@ public:
 	return queue.getMinimumPriority();
     }
     void sync() const { queue.sync(); }
+    unsigned int getQueueDepth() const { return queue.getDepth(); }
 
     template <typename T>
     T *getLocal(const std::string &name) {